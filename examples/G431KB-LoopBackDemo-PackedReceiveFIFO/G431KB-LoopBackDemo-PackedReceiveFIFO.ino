@@ -0,0 +1,110 @@
+// LoopBackDemo-PackedReceiveFIFO
+
+// This demo runs on NUCLEO_G431KB
+// Driver receive FIFO 0 is a packed ring: an 8-byte frame takes 16 bytes
+// instead of sizeof (CANFDMessage) = 72 bytes, so a 1748-byte buffer holds up
+// to 100 classic frames (24 CANFDMessage slots in the same RAM). Every second,
+// a burst of 64 frames is sent, and received frames are read only after it:
+// the burst is absorbed without driver receive FIFO overflow (statusFlags bit 1).
+// The FIFO storage is sized by ACANFD_STM32_FIFO::packedStorageWordCount for
+// 99 classic (8-byte) frames. Its maximum payload remains 64, the payload of
+// G4 hardware Rx FIFO elements (beginFD rejects a lower value): a longer CANFD
+// frame is still received, it only takes more room.
+// The FDCAN module is configured in external loop back mode: it
+// internally receives every CAN frame it sends, and emitted frames
+// can be observed on TxCAN pin (PA12). No external hardware is required.
+
+#ifndef ARDUINO_NUCLEO_G431KB
+  #error This sketch runs on NUCLEO-G431KB Nucleo-32 board
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_STM32.h> should be included only once, generally from the .ino file
+//   From an other file, include <ACANFD_STM32_from_cpp.h>
+//-----------------------------------------------------------------
+
+#include <ACANFD_STM32.h>
+
+//-----------------------------------------------------------------
+//  Driver receive FIFO 0 packed storage (1748 bytes, 148 of them
+//  for the FIFO staging messages)
+//-----------------------------------------------------------------
+
+static const uint8_t RECEIVE_FIFO_0_FRAME_PAYLOAD = 8 ;
+
+static uint32_t gReceiveFIFO0PackedStorage [ACANFD_STM32_FIFO::packedStorageWordCount (99, RECEIVE_FIFO_0_FRAME_PAYLOAD)] ;
+
+//-----------------------------------------------------------------
+
+static const uint32_t BURST_SIZE = 64 ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    delay (50) ;
+  }
+
+  ACANFD_STM32_Settings settings (500 * 1000, DataBitRateFactor::x5) ;
+  settings.mModuleMode = ACANFD_STM32_Settings::EXTERNAL_LOOP_BACK ;
+  settings.mDriverTransmitFIFOSize = BURST_SIZE ;
+  settings.setDriverReceiveFIFO0PackedStorage (gReceiveFIFO0PackedStorage) ;
+
+  const uint32_t errorCode = fdcan1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("fdcan1 ok") ;
+  }else{
+    Serial.print ("Error fdcan1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  Serial.print ("Driver receive FIFO 0 size (frames without payload): ") ;
+  Serial.println (fdcan1.driverReceiveFIFO0Size ()) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gBurstDate = 0 ;
+static uint32_t gReceivedCount = 0 ;
+static bool gBurstSent = false ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gBurstDate < millis ()) {
+    gBurstDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANFDMessage message ;
+    message.type = CANFDMessage::CAN_DATA ;
+    message.len = 8 ;
+    for (uint32_t i=0 ; i<BURST_SIZE ; i++) {
+      message.id = 0x100 + i ;
+      message.data32 [0] = i ;
+      fdcan1.tryToSendReturnStatusFD (message) ;
+    }
+    gBurstSent = true ;
+  }
+//--- Read received frames when burst is completed
+  if (gBurstSent && (fdcan1.transmitFIFOCount () == 0)) {
+    gBurstSent = false ;
+    delay (5) ; // Last frames
+    CANFDMessage message ;
+    while (fdcan1.receiveFD0 (message)) {
+      gReceivedCount += 1 ;
+    }
+    Serial.print ("Received: ") ;
+    Serial.print (gReceivedCount) ;
+    Serial.print (", peak count: ") ;
+    Serial.print (fdcan1.driverReceiveFIFO0PeakCount ()) ;
+    Serial.print (", dropped: ") ;
+    Serial.print (fdcan1.driverReceiveFIFO0DroppedCount ()) ;
+    Serial.print (", status flags: 0x") ;
+    Serial.println (fdcan1.statusFlags (), HEX) ;
+    fdcan1.resetDriverReceiveFIFO0PeakCount () ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,93 @@
+// LoopBackDemo-StaticStorage
+
+// This demo runs on NUCLEO_G431KB
+// Driver FIFOs use statically allocated arrays instead of the heap: their
+// footprint appears in the linker memory report, and beginFD does not
+// allocate them.
+// The FDCAN module is configured in external loop back mode: it
+// internally receives every CAN frame it sends, and emitted frames
+// can be observed on TxCAN pin (PA12). No external hardware is required.
+
+#ifndef ARDUINO_NUCLEO_G431KB
+  #error This sketch runs on NUCLEO-G431KB Nucleo-32 board
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_STM32.h> should be included only once, generally from the .ino file
+//   From an other file, include <ACANFD_STM32_from_cpp.h>
+//-----------------------------------------------------------------
+
+#include <ACANFD_STM32.h>
+
+//-----------------------------------------------------------------
+//  Driver FIFO storage
+//-----------------------------------------------------------------
+
+static CANFDMessage gTransmitFIFOStorage [8] ;
+static ACANFD_STM32_TxOptions gTransmitFIFOTxOptionsStorage [8] ;
+static uint16_t gTransmitFIFOSlotOrderStorage [8] ;
+static CANFDMessage gReceiveFIFO0Storage [16] ;
+static CANFDMessage gReceiveFIFO1Storage [4] ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    delay (50) ;
+  }
+
+  ACANFD_STM32_Settings settings (500 * 1000, DataBitRateFactor::x5) ;
+  settings.mModuleMode = ACANFD_STM32_Settings::EXTERNAL_LOOP_BACK ;
+//--- FIFO sizes are the array sizes
+  settings.setDriverTransmitFIFOStorage (gTransmitFIFOStorage, gTransmitFIFOTxOptionsStorage, gTransmitFIFOSlotOrderStorage) ;
+  settings.setDriverReceiveFIFO0Storage (gReceiveFIFO0Storage) ;
+  settings.setDriverReceiveFIFO1Storage (gReceiveFIFO1Storage) ;
+
+  const uint32_t errorCode = fdcan1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("fdcan1 ok") ;
+  }else{
+    Serial.print ("Error fdcan1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+  Serial.print ("Driver transmit FIFO size: ") ;
+  Serial.println (fdcan1.transmitFIFOSize ()) ;
+  Serial.print ("Driver receive FIFO 0 size: ") ;
+  Serial.println (fdcan1.driverReceiveFIFO0Size ()) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gSendDate = 0 ;
+static uint32_t gSentCount = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  if (gSendDate < millis ()) {
+    gSendDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    CANFDMessage message ;
+    message.id = 0x7FF ;
+    message.len = 8 ;
+    const uint32_t sendStatus = fdcan1.tryToSendReturnStatusFD (message) ;
+    if (sendStatus == 0) {
+      gSentCount += 1 ;
+      Serial.print ("Sent: ") ;
+      Serial.println (gSentCount) ;
+    }
+  }
+  CANFDMessage messageFD ;
+  if (fdcan1.receiveFD0 (messageFD)) {
+    gReceivedCount += 1 ;
+    Serial.print ("Received: ") ;
+    Serial.println (gReceivedCount) ;
+  }
+}
+
+//-----------------------------------------------------------------
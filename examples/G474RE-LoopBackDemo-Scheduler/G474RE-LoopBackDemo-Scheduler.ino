@@ -0,0 +1,109 @@
+//-----------------------------------------------------------------
+// This demo runs on NUCLEO_G474RE
+// fdcan1 is configured in external loop back mode: it internally
+// receives every CAN frame it sends, and emitted frames can be
+// observed on TxCAN pin (PA_12). No external hardware is required.
+// Periodic frames are sent by a scheduler driven by TIM6 (1 ms tick):
+//   - 0x100, every 10 ms, payload from a buffer,
+//   - 0x101, every 10 ms, payload updated by a provider callback,
+//   - 0x102, every 100 ms, constant payload.
+// Phases are spread automatically, so 0x100 and 0x101 are not
+// sent during the same tick.
+//-----------------------------------------------------------------
+
+#ifndef ARDUINO_NUCLEO_G474RE
+  #error This sketch runs on NUCLEO-G474RE Nucleo-64 board
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_STM32.h> should be included only once in a sketch, generally from the .ino file
+//   From an other file, include <ACANFD_STM32_from_cpp.h>
+//-----------------------------------------------------------------
+
+#include <ACANFD_STM32.h>
+#include <ACANFD_STM32_Scheduler.h>
+
+//-----------------------------------------------------------------
+
+static ACANFD_STM32_Scheduler gScheduler (fdcan1, 8) ;
+
+static volatile uint8_t gPayloadBuffer [8] ;
+
+//-----------------------------------------------------------------
+
+static bool counterProvider (CANFDMessage & ioMessage) {
+  ioMessage.data32 [0] += 1 ;
+  return true ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    delay (50) ;
+  }
+
+  ACANFD_STM32_Settings settings (500 * 1000, DataBitRateFactor::x2) ;
+  settings.mModuleMode = ACANFD_STM32_Settings::EXTERNAL_LOOP_BACK ;
+
+  const uint32_t errorCode = fdcan1.beginFD (settings) ;
+  if (0 == errorCode) {
+    Serial.println ("fdcan1 configuration ok") ;
+  }else{
+    Serial.print ("Error fdcan1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }
+
+//--- Periodic messages (period in ticks)
+  CANFDMessage message ;
+  message.len = 8 ;
+  message.id = 0x100 ;
+  gScheduler.addPeriodicMessageWithBuffer (message, 10, gPayloadBuffer) ;
+  message.id = 0x101 ;
+  message.data64 [0] = 0 ;
+  gScheduler.addPeriodicMessage (message, 10, counterProvider) ;
+  message.id = 0x102 ;
+  message.data64 [0] = 0x0706050403020100ULL ;
+  gScheduler.addPeriodicMessage (message, 100) ;
+  for (uint16_t i=0 ; i<gScheduler.count () ; i++) {
+    Serial.print ("Message ") ;
+    Serial.print (i) ;
+    Serial.print (", phase ") ;
+    Serial.println (gScheduler.phaseOfMessageAtIndex (i)) ;
+  }
+
+//--- Start scheduler: tick is 1000 µs, timer interrupt priority is the
+//    FDCAN interrupt priority
+  gScheduler.begin (TIM6, 1000) ;
+}
+
+//-----------------------------------------------------------------
+
+static uint32_t gDisplayDate = 0 ;
+static uint32_t gReceivedCount = 0 ;
+
+//-----------------------------------------------------------------
+
+void loop () {
+  CANFDMessage messageFD ;
+  while (fdcan1.receiveFD0 (messageFD)) {
+    gReceivedCount += 1 ;
+  }
+  if (gDisplayDate < millis ()) {
+    gDisplayDate += 1000 ;
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    gPayloadBuffer [0] += 1 ;
+    Serial.print ("Sent: ") ;
+    Serial.print (gScheduler.sentCount ()) ;
+    Serial.print (", missed: ") ;
+    Serial.print (gScheduler.missedCount ()) ;
+    Serial.print (", received: ") ;
+    Serial.println (gReceivedCount) ;
+  }
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,119 @@
+// FastMemoryBenchmark
+
+// This benchmark runs on NUCLEO_H743ZI2
+// It measures (DWT cycle counter) isr1 execution time for receiving frames,
+// and isr0 execution time for refilling the hardware Tx FIFO.
+// Run it twice:
+//   - without fast memories (interrupt path in flash, driver FIFOs in RAM);
+//   - with fast memories: add the extras/linker-fragments/H7-ITCM-DTCM.ld
+//     sections to the board linker script, and create a build_opt.h file in
+//     the sketch folder, containing: -DACANFD_STM32_USE_FAST_MEMORIES
+//     (interrupt path in ITCM, driver FIFOs in DTCM).
+// The FDCAN1 module is configured in internal loop back mode, no external
+// hardware is required.
+
+#ifndef ARDUINO_NUCLEO_H743ZI2
+  #error This sketch runs on NUCLEO-H743ZI2 Nucleo-144 board
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_STM32.h> should be included only once, generally from the .ino file
+//   From an other file, include <ACANFD_STM32_from_cpp.h>
+//   Before including <ACANFD_STM32.h>, you should define
+//   Message RAM size for FDCAN1 and Message RAM size for FDCAN2.
+//-----------------------------------------------------------------
+
+static const uint32_t FDCAN1_MESSAGE_RAM_WORD_SIZE = 2560 ;
+static const uint32_t FDCAN2_MESSAGE_RAM_WORD_SIZE = 0 ; // FDCAN2 not used
+
+#include <ACANFD_STM32.h>
+
+//-----------------------------------------------------------------
+//  Driver FIFO storage (in DTCM if fast memories are enabled)
+//-----------------------------------------------------------------
+
+static const uint16_t FRAME_COUNT = 32 ;
+
+ACANFD_STM32_FAST_DATA static CANFDMessage gTransmitFIFOStorage [FRAME_COUNT] ;
+ACANFD_STM32_FAST_DATA static ACANFD_STM32_TxOptions gTransmitFIFOTxOptionsStorage [FRAME_COUNT] ;
+ACANFD_STM32_FAST_DATA static uint16_t gTransmitFIFOSlotOrderStorage [FRAME_COUNT] ;
+ACANFD_STM32_FAST_DATA static CANFDMessage gReceiveFIFO0Storage [FRAME_COUNT] ;
+ACANFD_STM32_FAST_DATA static CANFDMessage gReceiveFIFO1Storage [1] ;
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    delay (50) ;
+  }
+//--- Enable cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk ;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk ;
+//--- Configure fdcan1
+  ACANFD_STM32_Settings settings (1000 * 1000, DataBitRateFactor::x1) ;
+  settings.mModuleMode = ACANFD_STM32_Settings::INTERNAL_LOOP_BACK ;
+  settings.mHardwareDedicacedTxBufferCount = 0 ;
+  settings.mHardwareTransmitTxFIFOSize = FRAME_COUNT ;
+  settings.mHardwareRxFIFO0Size = FRAME_COUNT ;
+  settings.setDriverTransmitFIFOStorage (gTransmitFIFOStorage, gTransmitFIFOTxOptionsStorage, gTransmitFIFOSlotOrderStorage) ;
+  settings.setDriverReceiveFIFO0Storage (gReceiveFIFO0Storage) ;
+  settings.setDriverReceiveFIFO1Storage (gReceiveFIFO1Storage) ;
+  const uint32_t errorCode = fdcan1.beginFD (settings) ;
+  if (errorCode != 0) {
+    Serial.print ("Error fdcan1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }else{
+    Serial.print ("Fast memories: ") ;
+    Serial.println (ACANFD_STM32_FastMemory::enabled () ? "yes" : "no") ;
+  //--- isr0 and isr1 are called by the benchmark, not by the interrupts
+    NVIC_DisableIRQ (FDCAN1_IT0_IRQn) ;
+    NVIC_DisableIRQ (FDCAN1_IT1_IRQn) ;
+  //--- Send frames: they fill hardware Tx FIFO, then driver transmit FIFO
+    CANFDMessage message ;
+    message.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    message.len = 64 ;
+    for (uint32_t i=0 ; i<(2U * FRAME_COUNT) ; i++) {
+      message.id = i ;
+      fdcan1.tryToSendReturnStatusFD (message) ;
+    }
+  //--- Wait until hardware Tx FIFO is empty: the hardware Rx FIFO 0 is full
+    while ((FDCAN1->TXFQS & 0x3F) < FRAME_COUNT) {}
+  //--- isr0: refill hardware Tx FIFO
+    uint32_t start = DWT->CYCCNT ;
+    fdcan1.isr0 () ;
+    const uint32_t isr0Cycles = DWT->CYCCNT - start ;
+  //--- isr1: move received frames into driver receive FIFO 0
+    start = DWT->CYCCNT ;
+    fdcan1.isr1 () ;
+    const uint32_t isr1Cycles = DWT->CYCCNT - start ;
+    const uint32_t receivedCount = fdcan1.driverReceiveFIFO0Count () ;
+  //--- Display
+    Serial.print ("isr0, ") ;
+    Serial.print (FRAME_COUNT) ;
+    Serial.print (" frames written: ") ;
+    Serial.print (isr0Cycles) ;
+    Serial.println (" cycles") ;
+    Serial.print ("isr1, ") ;
+    Serial.print (receivedCount) ;
+    Serial.print (" frames read: ") ;
+    Serial.print (isr1Cycles) ;
+    Serial.println (" cycles") ;
+    NVIC_EnableIRQ (FDCAN1_IT0_IRQn) ;
+    NVIC_EnableIRQ (FDCAN1_IT1_IRQn) ;
+  }
+}
+
+//-----------------------------------------------------------------
+
+void loop () {
+  CANFDMessage message ;
+  fdcan1.receiveFD0 (message) ;
+  digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  delay (500) ;
+}
+
+//-----------------------------------------------------------------
@@ -0,0 +1,166 @@
+// TxFIFORefillBenchmark
+
+// This benchmark runs on NUCLEO_H743ZI2
+// It measures (DWT cycle counter) the time isr0 takes for refilling an empty
+// hardware Tx FIFO from the driver transmit FIFO, for hardware Tx FIFO sizes
+// of 1, 3 and 32 elements. TXFQS is read once per refill, and transmission is
+// requested by a single TXBAR write. For comparison, referenceRefill refills
+// the same hardware Tx FIFO the per frame way: it reads TXFQS and writes TXBAR
+// for every frame. Both results are printed as cycles per frame (for isr0,
+// its cycle count without frame to move is subtracted).
+// The FDCAN1 module is configured in internal loop back mode, no external
+// hardware is required.
+
+#ifndef ARDUINO_NUCLEO_H743ZI2
+  #error This sketch runs on NUCLEO-H743ZI2 Nucleo-144 board
+#endif
+
+//-----------------------------------------------------------------
+// IMPORTANT:
+//   <ACANFD_STM32.h> should be included only once, generally from the .ino file
+//   From an other file, include <ACANFD_STM32_from_cpp.h>
+//   Before including <ACANFD_STM32.h>, you should define
+//   Message RAM size for FDCAN1 and Message RAM size for FDCAN2.
+//-----------------------------------------------------------------
+
+static const uint32_t FDCAN1_MESSAGE_RAM_WORD_SIZE = 2560 ;
+static const uint32_t FDCAN2_MESSAGE_RAM_WORD_SIZE = 0 ; // FDCAN2 not used
+
+#include <ACANFD_STM32.h>
+
+//-----------------------------------------------------------------
+//  Reference refill: TXFQS read and TXBAR write for every frame.
+//  Tx FIFO elements are written in message RAM as the driver does
+//  (CANFD frames with bit rate switch, no Tx event).
+//-----------------------------------------------------------------
+
+static uint32_t referenceRefill (const CANFDMessage * inMessages,
+                                 const uint32_t inCount) {
+  volatile uint32_t * txBuffers = (volatile uint32_t *) (SRAMCAN_BASE + (FDCAN1->TXBC & 0xFFFC)) ;
+  const uint32_t elementWordCount = ACANFD_STM32_Settings::wordCountForPayload (
+    ACANFD_STM32_Settings::Payload (FDCAN1->TXESC & 7)
+  ) ;
+  uint32_t n = 0 ;
+  bool loop = inCount > 0 ;
+  while (loop) {
+    const uint32_t txfqs = FDCAN1->TXFQS ;
+    loop = (txfqs & (1U << 21)) == 0 ; // TFQF: Tx FIFO full
+    if (loop) {
+      const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+      volatile uint32_t * txBufferPtr = txBuffers + putIndex * elementWordCount ;
+      const CANFDMessage & message = inMessages [n] ;
+      for (uint32_t i=0 ; i<16 ; i++) {
+        txBufferPtr [i+2] = message.data32 [i] ;
+      }
+      txBufferPtr [0] = (message.id & 0x7FFU) << 18 ;
+      txBufferPtr [1] = (15U << 16) | (1U << 21) | (1U << 20) ; // 64 bytes, FDF, BRS
+      FDCAN1->TXBAR = 1U << putIndex ;
+      n += 1 ;
+      loop = n < inCount ;
+    }
+  }
+  return n ;
+}
+
+//-----------------------------------------------------------------
+
+static CANFDMessage gReferenceMessages [32] ;
+
+//-----------------------------------------------------------------
+
+static void benchmark (const uint8_t inHardwareTxFIFOSize) {
+  ACANFD_STM32_Settings settings (1000 * 1000, DataBitRateFactor::x1) ;
+  settings.mModuleMode = ACANFD_STM32_Settings::INTERNAL_LOOP_BACK ;
+  settings.mHardwareDedicacedTxBufferCount = 0 ;
+  settings.mHardwareTransmitTxFIFOSize = inHardwareTxFIFOSize ;
+  settings.mHardwareTransmitBufferPayload = ACANFD_STM32_Settings::PAYLOAD_64_BYTES ; // referenceRefill writes 64-byte frames
+  settings.mDriverTransmitFIFOSize = 64 ;
+  const uint32_t errorCode = fdcan1.beginFD (settings) ;
+  if (errorCode != 0) {
+    Serial.print ("Error fdcan1: 0x") ;
+    Serial.println (errorCode, HEX) ;
+  }else{
+  //--- isr0 is called by the benchmark, not by the interrupt
+    NVIC_DisableIRQ (FDCAN1_IT0_IRQn) ;
+  //--- Fill hardware Tx FIFO, then driver transmit FIFO
+    CANFDMessage message ;
+    message.type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+    message.len = 64 ;
+    for (uint32_t i=0 ; i<(2U * inHardwareTxFIFOSize) ; i++) {
+      message.id = i ;
+      fdcan1.tryToSendReturnStatusFD (message) ;
+    }
+  //--- Wait until hardware Tx FIFO is empty
+    while ((FDCAN1->TXFQS & 0x3F) < inHardwareTxFIFOSize) {}
+  //--- Refill
+    const uint32_t queuedCount = fdcan1.transmitFIFOCount () ;
+    const uint32_t start = DWT->CYCCNT ;
+    fdcan1.isr0 () ;
+    const uint32_t cycles = DWT->CYCCNT - start ;
+    const uint32_t movedCount = queuedCount - fdcan1.transmitFIFOCount () ;
+  //--- Empty isr0 (no message to move)
+    while ((FDCAN1->TXFQS & 0x3F) < inHardwareTxFIFOSize) {}
+    const uint32_t emptyStart = DWT->CYCCNT ;
+    fdcan1.isr0 () ;
+    const uint32_t emptyCycles = DWT->CYCCNT - emptyStart ;
+  //--- Reference refill of the empty hardware Tx FIFO
+    while ((FDCAN1->TXFQS & 0x3F) < inHardwareTxFIFOSize) {}
+    for (uint32_t i=0 ; i<inHardwareTxFIFOSize ; i++) {
+      gReferenceMessages [i].type = CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH ;
+      gReferenceMessages [i].len = 64 ;
+      gReferenceMessages [i].id = 0x100 + i ;
+    }
+    const uint32_t referenceStart = DWT->CYCCNT ;
+    const uint32_t referenceCount = referenceRefill (gReferenceMessages, inHardwareTxFIFOSize) ;
+    const uint32_t referenceCycles = DWT->CYCCNT - referenceStart ;
+    while ((FDCAN1->TXFQS & 0x3F) < inHardwareTxFIFOSize) {}
+  //--- Display
+    Serial.print ("Hardware Tx FIFO size ") ;
+    Serial.print (inHardwareTxFIFOSize) ;
+    Serial.print (": batched refill, ") ;
+    Serial.print (movedCount) ;
+    Serial.print (" frames moved in ") ;
+    Serial.print (cycles) ;
+    Serial.print (" cycles (") ;
+    Serial.print ((cycles - emptyCycles) / ((movedCount > 0) ? movedCount : 1)) ;
+    Serial.print (" cycles per frame, isr0 without frame: ") ;
+    Serial.print (emptyCycles) ;
+    Serial.println (" cycles)") ;
+    Serial.print ("  per frame refill, ") ;
+    Serial.print (referenceCount) ;
+    Serial.print (" frames written in ") ;
+    Serial.print (referenceCycles) ;
+    Serial.print (" cycles (") ;
+    Serial.print (referenceCycles / ((referenceCount > 0) ? referenceCount : 1)) ;
+    Serial.println (" cycles per frame)") ;
+    NVIC_EnableIRQ (FDCAN1_IT0_IRQn) ;
+  }
+  fdcan1.end () ;
+}
+
+//-----------------------------------------------------------------
+
+void setup () {
+  pinMode (LED_BUILTIN, OUTPUT) ;
+  Serial.begin (9600) ;
+  while (!Serial) {
+    digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+    delay (50) ;
+  }
+//--- Enable cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk ;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk ;
+//--- Benchmarks
+  benchmark (1) ;
+  benchmark (3) ;
+  benchmark (32) ;
+}
+
+//-----------------------------------------------------------------
+
+void loop () {
+  digitalWrite (LED_BUILTIN, !digitalRead (LED_BUILTIN)) ;
+  delay (500) ;
+}
+
+//-----------------------------------------------------------------
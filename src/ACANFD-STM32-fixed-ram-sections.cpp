@@ -3,6 +3,7 @@
 //------------------------------------------------------------------------------
 
 #include <ACANFD_STM32_from_cpp.h>
+#include <ACANFD_STM32_UninitializedMessage.h>
 
 //------------------------------------------------------------------------------
 
@@ -15,6 +16,7 @@
 //------------------------------------------------------------------------------
 
 static const uint32_t WORD_COUNT_FOR_PAYLOAD_64_BYTES = 18 ;
+static const uint32_t HARDWARE_TX_FIFO_SIZE = 3 ;
 
 //------------------------------------------------------------------------------
 //    Constructor
@@ -52,12 +54,25 @@ uint32_t ACANFD_STM32::beginFD (const ACANFD_STM32_Settings & inSettings,
 
 
 //------------------------------------------------------ Check settings
+  if ((inSettings.mDriverTransmitFIFOStorage != nullptr)
+   && ((inSettings.mDriverTransmitFIFOTxOptionsStorage == nullptr) || (inSettings.mDriverTransmitFIFOSlotOrderStorage == nullptr))) {
+    errorFlags |= kIncompleteDriverTransmitFIFOStorage ;
+  }
+  if ((inSettings.mDriverReceiveFIFO0MaxPayload < 64) || (inSettings.mDriverReceiveFIFO1MaxPayload < 64)) {
+    errorFlags |= kDriverReceiveFIFOMaxPayloadTooSmall ; // Hardware Rx FIFO elements have a 64-byte payload
+  }
   if (inStandardFilters.count () > 28) {
     errorFlags |= kTooManyStandardFilters ;
   }
   if (inExtendedFilters.count () > 8) {
     errorFlags |= kTooManyExtendedFilters ;
   }
+  if (inSettings.mIRQPriority && (inSettings.mIRQPriority.value () >= (1U << __NVIC_PRIO_BITS))) {
+    errorFlags |= kIRQPriorityTooLarge ;
+  }
+  if ((inSettings.mTimeStampPrescaler == 0) || (inSettings.mTimeStampPrescaler > 16)) {
+    errorFlags |= kInvalidTimeStampPrescaler ;
+  }
 
 //---------------------------------------------- Configure TxPin
   bool pinFound = inSettings.mTxPin == 255 ; // Use default TxPin ?
@@ -118,6 +133,9 @@ uint32_t ACANFD_STM32::beginFD (const ACANFD_STM32_Settings & inSettings,
   }
 
 
+//------------------------------------------------------ Copy interrupt path into fast memory (if enabled)
+  ACANFD_STM32_FastMemory::copyCode () ;
+
 //------------------------------------------------------ Start configuring CAN module
   mPeripheralPtr->CCCR = FDCAN_CCCR_INIT ;
   while ((mPeripheralPtr->CCCR & FDCAN_CCCR_INIT) == 0) {
@@ -182,6 +200,31 @@ uint32_t ACANFD_STM32::beginFD (const ACANFD_STM32_Settings & inSettings,
   mPeripheralPtr->TDCR = inSettings.mTransceiverDelayCompensation << 8 ;
 
 
+//------------------------------------------------------ Time Stamp Counter
+  mPeripheralPtr->TSCC =
+    ((uint32_t (inSettings.mTimeStampPrescaler - 1) & 0xF) << FDCAN_TSCC_TCP_Pos)
+  |
+    (uint32_t (inSettings.mTimeStampSource) << FDCAN_TSCC_TSS_Pos)
+  ;
+  switch (inSettings.mTimeStampSource) {
+  case ACANFD_STM32_Settings::TIME_STAMP_DISABLED :
+    mTimeStampFrequency = 0 ;
+    break ;
+  case ACANFD_STM32_Settings::TIME_STAMP_INTERNAL_COUNTER :
+    mTimeStampFrequency = (inSettings.mTimeStampPrescaler > 0)
+      ? (inSettings.actualArbitrationBitRate () / inSettings.mTimeStampPrescaler)
+      : 0
+    ;
+    break ;
+  case ACANFD_STM32_Settings::TIME_STAMP_EXTERNAL_COUNTER :
+    mTimeStampFrequency = inSettings.mExternalTimeStampFrequency ;
+    break ;
+  }
+
+//------------------------------------------------------ Latest value cache
+  mLatestValueCache = inSettings.mLatestValueCache ;
+
+
 //------------------------------------------------------ Global Filter Configuration
   mPeripheralPtr->RXGFC =
     (uint32_t (inSettings.mNonMatchingStandardFrameReception) << FDCAN_RXGFC_ANFS_Pos)
@@ -196,7 +239,16 @@ uint32_t ACANFD_STM32::beginFD (const ACANFD_STM32_Settings & inSettings,
   |
     (inExtendedFilters.count () << FDCAN_RXGFC_LSE_Pos) // Standard filter count (up to 8)
   ;
+  if (inSettings.mRxFIFO0OverflowPolicy == ACANFD_STM32_Settings::FIFO_HARDWARE_OVERWRITE) {
+    mPeripheralPtr->RXGFC |= FDCAN_RXGFC_F0OM ; // Rx FIFO 0 overwrite mode
+  }
+  if (inSettings.mRxFIFO1OverflowPolicy == ACANFD_STM32_Settings::FIFO_HARDWARE_OVERWRITE) {
+    mPeripheralPtr->RXGFC |= FDCAN_RXGFC_F1OM ; // Rx FIFO 1 overwrite mode
+  }
+
 
+//------------------------------------------------------ Tx Buffer Configuration: Tx FIFO or Tx Queue
+  mPeripheralPtr->TXBC = inSettings.mTransmitPriorityQueue ? FDCAN_TXBC_TFQM : 0 ;
 
 //-------------------- Allocate Standard ID Filters (0 ... 28 elements -> 0 ... 28 words)
   mStandardFilterCallBackArray.setCapacity (inStandardFilters.count ()) ;
@@ -218,25 +270,118 @@ uint32_t ACANFD_STM32::beginFD (const ACANFD_STM32_Settings & inSettings,
 
   if (errorFlags == 0) {
   //------------------------------------------------------ Configure Driver buffers
-    mDriverTransmitFIFO.initWithSize (inSettings.mDriverTransmitFIFOSize) ;
-    mDriverReceiveFIFO0.initWithSize (inSettings.mDriverReceiveFIFO0Size) ;
-    mDriverReceiveFIFO1.initWithSize (inSettings.mDriverReceiveFIFO1Size) ;
+    if (inSettings.mDriverTransmitFIFOStorage != nullptr) {
+      mDriverTransmitFIFO.initWithBuffer (
+        inSettings.mDriverTransmitFIFOStorage,
+        inSettings.mDriverTransmitFIFOSize,
+        inSettings.mDriverTransmitFIFOTxOptionsStorage,
+        inSettings.mDriverTransmitFIFOSlotOrderStorage
+      ) ;
+    }else{
+      mDriverTransmitFIFO.initWithSize (inSettings.mDriverTransmitFIFOSize, true) ; // With transmit options
+    }
+    mDriverTxEventFIFO.initWithSize (inSettings.mDriverTxEventFIFOSize) ;
+    mTransmitPriorityQueue = inSettings.mTransmitPriorityQueue ;
+    mTransmitWaitRoutine = inSettings.mTransmitWaitRoutine ;
+    mTransmitSignalRoutine = inSettings.mTransmitSignalRoutine ;
+    mTxBufferReserved = false ;
+    mTxBufferDeadlineMask = 0 ;
+    mTxBufferCancelRequestMask = 0 ;
+    mTxCompletionPendingMask = 0 ;
+    mTxCompletionReadyMask = 0 ;
+    const bool withTimeStamps = inSettings.mTimeStampSource != ACANFD_STM32_Settings::TIME_STAMP_DISABLED ;
+    const uint8_t maxPayload0 = inSettings.mDriverReceiveFIFO0MaxPayload ;
+    if (inSettings.mDriverReceiveFIFO0PackedStorage != nullptr) {
+      mDriverReceiveFIFO0.initPackedWithBuffer (inSettings.mDriverReceiveFIFO0PackedStorage, inSettings.mDriverReceiveFIFO0PackedByteSize / 4, maxPayload0) ;
+    }else if (inSettings.mDriverReceiveFIFO0PackedByteSize > 0) {
+      mDriverReceiveFIFO0.initPackedWithSize (inSettings.mDriverReceiveFIFO0PackedByteSize, maxPayload0) ;
+    }else if (inSettings.mDriverReceiveFIFO0Storage != nullptr) {
+      mDriverReceiveFIFO0.initWithBuffer (
+        inSettings.mDriverReceiveFIFO0Storage,
+        inSettings.mDriverReceiveFIFO0Size,
+        nullptr,
+        nullptr,
+        inSettings.mDriverReceiveFIFO0TimeStampStorage
+      ) ;
+    }else if (maxPayload0 < 64) {
+      mDriverReceiveFIFO0.initPackedWithSize (
+        4 * ACANFD_STM32_FIFO::packedStorageWordCount (inSettings.mDriverReceiveFIFO0Size, maxPayload0),
+        maxPayload0
+      ) ;
+    }else{
+      mDriverReceiveFIFO0.initWithSize (inSettings.mDriverReceiveFIFO0Size, false, withTimeStamps) ;
+    }
+    const uint8_t maxPayload1 = inSettings.mDriverReceiveFIFO1MaxPayload ;
+    if (inSettings.mDriverReceiveFIFO1PackedStorage != nullptr) {
+      mDriverReceiveFIFO1.initPackedWithBuffer (inSettings.mDriverReceiveFIFO1PackedStorage, inSettings.mDriverReceiveFIFO1PackedByteSize / 4, maxPayload1) ;
+    }else if (inSettings.mDriverReceiveFIFO1PackedByteSize > 0) {
+      mDriverReceiveFIFO1.initPackedWithSize (inSettings.mDriverReceiveFIFO1PackedByteSize, maxPayload1) ;
+    }else if (inSettings.mDriverReceiveFIFO1Storage != nullptr) {
+      mDriverReceiveFIFO1.initWithBuffer (
+        inSettings.mDriverReceiveFIFO1Storage,
+        inSettings.mDriverReceiveFIFO1Size,
+        nullptr,
+        nullptr,
+        inSettings.mDriverReceiveFIFO1TimeStampStorage
+      ) ;
+    }else if (maxPayload1 < 64) {
+      mDriverReceiveFIFO1.initPackedWithSize (
+        4 * ACANFD_STM32_FIFO::packedStorageWordCount (inSettings.mDriverReceiveFIFO1Size, maxPayload1),
+        maxPayload1
+      ) ;
+    }else{
+      mDriverReceiveFIFO1.initWithSize (inSettings.mDriverReceiveFIFO1Size, false, withTimeStamps) ;
+    }
     mNonMatchingStandardMessageCallBack = inSettings.mNonMatchingStandardMessageCallBack ;
     mNonMatchingExtendedMessageCallBack = inSettings.mNonMatchingExtendedMessageCallBack ;
   //------------------------------------------------------ Interrupts
     if (mIRQs) {
       uint32_t interruptRegister = FDCAN_IE_TCE ; // Enable Transmission Completed Interrupt
-      interruptRegister |= FDCAN_IE_RF0NE ; // Receive FIFO 0 Non Empty
-      interruptRegister |= FDCAN_IE_RF1NE ; // Receive FIFO 1 Non Empty
+      if (inSettings.mDriverTxEventFIFOSize > 0) {
+        interruptRegister |= FDCAN_IE_TEFNE ; // Tx Event FIFO New Entry
+      }
+      mReceiveInterruptMask = FDCAN_IE_RF0NE ; // Receive FIFO 0 Non Empty
+      mReceiveInterruptMask |= FDCAN_IE_RF1NE ; // Receive FIFO 1 Non Empty
+      interruptRegister |= mReceiveInterruptMask ;
       mPeripheralPtr->IE = interruptRegister ;
       mPeripheralPtr->TXBTIE = ~0U ;
       mPeripheralPtr->ILS = FDCAN_ILS_RXFIFO1 | FDCAN_ILS_RXFIFO0 ; // Received message on IRQ1, others on IRQ0
+      if (inSettings.mIRQPriority) { // Otherwise, NVIC priorities are not changed
+        NVIC_SetPriority (mIRQs.value ().mIRQ0, inSettings.mIRQPriority.value ()) ;
+        NVIC_SetPriority (mIRQs.value ().mIRQ1, inSettings.mIRQPriority.value ()) ;
+      }
+      const uint32_t irq0Priority = NVIC_GetPriority (mIRQs.value ().mIRQ0) ;
+      const uint32_t irq1Priority = NVIC_GetPriority (mIRQs.value ().mIRQ1) ;
+      mIRQPriority = uint8_t ((irq0Priority < irq1Priority) ? irq0Priority : irq1Priority) ; // Highest one
+      mCriticalSectionBasePriority = ACANFD_STM32_CriticalSection::basePriorityForIRQPriority (mIRQPriority) ;
       NVIC_EnableIRQ (mIRQs.value ().mIRQ0) ;
       NVIC_EnableIRQ (mIRQs.value ().mIRQ1) ;
+      mReceiveFrameBudget = inSettings.mReceiveFrameBudget ;
+      mDeferredReceiveIRQ = inSettings.mDeferredReceiveIRQ ;
+      mDeferredReceivePending = false ;
+      if (mDeferredReceiveIRQ && (mDeferredReceiveIRQ.value () >= 0)) {
+        const uint32_t lowestPriority = (1U << __NVIC_PRIO_BITS) - 1 ;
+        const uint32_t deferredReceivePriority = (mIRQPriority < lowestPriority) ? (mIRQPriority + 1) : lowestPriority ;
+        NVIC_SetPriority (mDeferredReceiveIRQ.value (), deferredReceivePriority) ; // Just lower than FDCAN interrupts
+        NVIC_EnableIRQ (mDeferredReceiveIRQ.value ()) ;
+      }
       mPeripheralPtr->ILE = FDCAN_ILE_EINT1 | FDCAN_ILE_EINT0 ;
     }else{
+      mIRQPriority = 0 ;
+      mCriticalSectionBasePriority = 0 ; // Poll mode: critical sections mask all interrupts
+      mReceiveFrameBudget = inSettings.mReceiveFrameBudget ;
+      mDeferredReceiveIRQ = std::nullopt ;
       mPeripheralPtr->IE = 0 ; // All interrupts disabled
     }
+  //------------------------------------------------------ Driver receive FIFO overflow policy
+    mDriverReceiveFIFO0.setOverwriteOldest (
+      inSettings.mRxFIFO0OverflowPolicy != ACANFD_STM32_Settings::FIFO_DROP_NEWEST,
+      mCriticalSectionBasePriority
+    ) ;
+    mDriverReceiveFIFO1.setOverwriteOldest (
+      inSettings.mRxFIFO1OverflowPolicy != ACANFD_STM32_Settings::FIFO_DROP_NEWEST,
+      mCriticalSectionBasePriority
+    ) ;
   //------------------------------------------------------ Activate CAN controller
     mPeripheralPtr->CCCR = FDCAN_CCCR_INIT | FDCAN_CCCR_CCE | cccr ;
     mPeripheralPtr->CCCR = cccr ; // Reset INIT bit
@@ -256,11 +401,35 @@ void ACANFD_STM32::end (void) {
     NVIC_DisableIRQ (mIRQs.value ().mIRQ0) ;
     NVIC_DisableIRQ (mIRQs.value ().mIRQ1) ;
   }
+//--- Disable deferred receive, a pending one would read freed FIFOs
+  if (mDeferredReceiveIRQ) {
+    if (mDeferredReceiveIRQ.value () >= 0) {
+      NVIC_DisableIRQ (mDeferredReceiveIRQ.value ()) ;
+      NVIC_ClearPendingIRQ (mDeferredReceiveIRQ.value ()) ;
+    }else if ((mDeferredReceiveIRQ.value () == PendSV_IRQn) && mDeferredReceivePending) {
+      SCB->ICSR = SCB_ICSR_PENDSVCLR_Msk ;
+    }
+    mDeferredReceiveIRQ = std::nullopt ;
+  }
+  mDeferredReceivePending = false ;
 //--- Free receive FIFOs
   mDriverReceiveFIFO0.free () ;
   mDriverReceiveFIFO1.free () ;
 //--- Free transmit FIFO
   mDriverTransmitFIFO.free () ;
+  mDriverTxEventFIFO.free () ;
+}
+
+//------------------------------------------------------------------------------
+//   Time stamp
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::timeStampTicksToMicroseconds (const uint32_t inTicks) const {
+  uint32_t result = 0 ;
+  if (mTimeStampFrequency > 0) {
+    result = uint32_t ((uint64_t (inTicks) * 1000000) / mTimeStampFrequency) ;
+  }
+  return result ;
 }
 
 //------------------------------------------------------------------------------
@@ -269,55 +438,67 @@ void ACANFD_STM32::end (void) {
 
 void ACANFD_STM32::poll (void) {
   if (!mIRQs) {
-    noInterrupts () ;
+    const uint32_t savedMask = enterCriticalSection () ;
       isr0 () ;
       isr1 () ;
-    interrupts () ;
+    leaveCriticalSection (savedMask) ;
   }
 }
 
 //------------------------------------------------------------------------------
 //   RECEPTION
 //------------------------------------------------------------------------------
+// Driver receive FIFOs are single producer (isr1) / single consumer rings,
+// so the following methods do not need any critical section (except with an
+// overwrite oldest overflow policy, the FIFO then masks isr1 while removing).
+// They should be called from a single context (usually the application loop).
+//------------------------------------------------------------------------------
 
 bool ACANFD_STM32::availableFD0 (void) {
-  noInterrupts () ;
-    const bool hasMessage = !mDriverReceiveFIFO0.isEmpty () ;
-  interrupts () ;
+  const bool hasMessage = !mDriverReceiveFIFO0.isEmpty () ;
   return hasMessage ;
 }
 
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32::receiveFD0 (CANFDMessage & outMessage) {
-  noInterrupts () ;
-    const bool hasMessage = mDriverReceiveFIFO0.remove (outMessage) ;
-  interrupts () ;
+  const bool hasMessage = mDriverReceiveFIFO0.remove (outMessage) ;
+  return hasMessage ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::receiveFD0 (CANFDMessage & outMessage, uint16_t & outTimeStamp) {
+  const bool hasMessage = mDriverReceiveFIFO0.remove (outMessage, outTimeStamp) ;
   return hasMessage ;
 }
 
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32::availableFD1 (void) {
-  noInterrupts () ;
-    const bool hasMessage = !mDriverReceiveFIFO1.isEmpty () ;
-  interrupts () ;
+  const bool hasMessage = !mDriverReceiveFIFO1.isEmpty () ;
   return hasMessage ;
 }
 
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32::receiveFD1 (CANFDMessage & outMessage) {
-  noInterrupts () ;
-    const bool hasMessage = mDriverReceiveFIFO1.remove (outMessage) ;
-  interrupts () ;
+  const bool hasMessage = mDriverReceiveFIFO1.remove (outMessage) ;
+  return hasMessage ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::receiveFD1 (CANFDMessage & outMessage, uint16_t & outTimeStamp) {
+  const bool hasMessage = mDriverReceiveFIFO1.remove (outMessage, outTimeStamp) ;
   return hasMessage ;
 }
 
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32::dispatchReceivedMessage (void) {
-  CANFDMessage message ;
+  ACANFD_STM32_UninitializedMessage messageStorage ;
+  CANFDMessage & message = messageStorage.message () ;
   bool result = false ;
   if (receiveFD0 (message)) {
     result = true ;
@@ -333,7 +514,8 @@ bool ACANFD_STM32::dispatchReceivedMessage (void) {
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32::dispatchReceivedMessageFIFO0 (void) {
-  CANFDMessage message ;
+  ACANFD_STM32_UninitializedMessage messageStorage ;
+  CANFDMessage & message = messageStorage.message () ;
   const bool result = receiveFD0 (message) ;
   if (result) {
     internalDispatchReceivedMessage (message) ;
@@ -344,7 +526,8 @@ bool ACANFD_STM32::dispatchReceivedMessageFIFO0 (void) {
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32::dispatchReceivedMessageFIFO1 (void) {
-  CANFDMessage message ;
+  ACANFD_STM32_UninitializedMessage messageStorage ;
+  CANFDMessage & message = messageStorage.message () ;
   const bool result = receiveFD1 (message) ;
   if (result) {
     internalDispatchReceivedMessage (message) ;
@@ -354,6 +537,77 @@ bool ACANFD_STM32::dispatchReceivedMessageFIFO1 (void) {
 
 //------------------------------------------------------------------------------
 
+uint32_t ACANFD_STM32::receiveFD0Batch (CANFDMessage * outArray,
+                                        const uint32_t inMaxCount,
+                                        uint16_t * outTimeStamps) {
+  const uint32_t n = mDriverReceiveFIFO0.removeArray (outArray, inMaxCount, outTimeStamps) ;
+  return n ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::receiveFD1Batch (CANFDMessage * outArray,
+                                        const uint32_t inMaxCount,
+                                        uint16_t * outTimeStamps) {
+  const uint32_t n = mDriverReceiveFIFO1.removeArray (outArray, inMaxCount, outTimeStamps) ;
+  return n ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::receiveFDBatch (CANFDMessage * outArray,
+                                       const uint32_t inMaxCount,
+                                       uint16_t * outTimeStamps) {
+  uint32_t n = mDriverReceiveFIFO0.removeArray (outArray, inMaxCount, outTimeStamps) ;
+  n += mDriverReceiveFIFO1.removeArray (
+    outArray + n,
+    inMaxCount - n,
+    (outTimeStamps == nullptr) ? nullptr : (outTimeStamps + n)
+  ) ;
+  return n ;
+}
+
+//------------------------------------------------------------------------------
+
+const CANFDMessage * ACANFD_STM32::peekFD0 (uint16_t * outTimeStampPtr) {
+  const CANFDMessage * messagePtr = mDriverReceiveFIFO0.peek (outTimeStampPtr) ;
+  return messagePtr ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::releaseFD0 (void) {
+  const bool released = mDriverReceiveFIFO0.release () ;
+  return released ;
+}
+
+//------------------------------------------------------------------------------
+
+const CANFDMessage * ACANFD_STM32::peekFD1 (uint16_t * outTimeStampPtr) {
+  const CANFDMessage * messagePtr = mDriverReceiveFIFO1.peek (outTimeStampPtr) ;
+  return messagePtr ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::releaseFD1 (void) {
+  const bool released = mDriverReceiveFIFO1.release () ;
+  return released ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::dispatchReceivedMessageBatch (CANFDMessage * ioWorkArray,
+                                                     const uint32_t inMaxCount) {
+  const uint32_t n = receiveFDBatch (ioWorkArray, inMaxCount) ;
+  for (uint32_t i=0 ; i<n ; i++) {
+    internalDispatchReceivedMessage (ioWorkArray [i]) ;
+  }
+  return n ;
+}
+
+//------------------------------------------------------------------------------
+
 void ACANFD_STM32::internalDispatchReceivedMessage (const CANFDMessage & inMessage) {
   const uint32_t filterIndex = inMessage.idx ;
   ACANFDCallBackRoutine callBack = nullptr ;
@@ -381,7 +635,7 @@ void ACANFD_STM32::internalDispatchReceivedMessage (const CANFDMessage & inMessa
 
 bool ACANFD_STM32::sendBufferNotFullForIndex (const uint32_t inMessageIndex) {
   bool canSend = false ;
-  noInterrupts () ;
+  const uint32_t savedMask = enterCriticalSection () ;
     if (inMessageIndex == 0) { // Send via Tx FIFO ?
       canSend = !mDriverTransmitFIFO.isFull () ;
     }else{ // Send via dedicaced Tx Buffer ?
@@ -391,25 +645,45 @@ bool ACANFD_STM32::sendBufferNotFullForIndex (const uint32_t inMessageIndex) {
         canSend = (mPeripheralPtr->TXBRP & (1U << txBufferIndex)) == 0 ;
       }
     }
-  interrupts () ;
+  leaveCriticalSection (savedMask) ;
   return canSend ;
 }
 
 //------------------------------------------------------------------------------
 
 uint32_t ACANFD_STM32::tryToSendReturnStatusFD (const CANFDMessage & inMessage) {
-  noInterrupts () ;
+  return tryToSendReturnStatusFD (inMessage, ACANFD_STM32_TxOptions ()) ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::tryToSendReturnStatusFD (const CANFDMessage & inMessage,
+                                                const ACANFDTxCompletionCallBack inCallBack) {
+  ACANFD_STM32_TxOptions txOptions ;
+  txOptions.mCallBack = inCallBack ;
+  return tryToSendReturnStatusFD (inMessage, txOptions) ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::tryToSendReturnStatusFD (const CANFDMessage & inMessage,
+                                                const ACANFD_STM32_TxOptions & inTxOptions) {
+  const uint32_t savedMask = enterCriticalSection () ;
     uint32_t sendStatus = 0 ; // Ok
     if (!inMessage.isValid ()) {
       sendStatus = kInvalidMessage ;
+    }else if ((inTxOptions.mDeadline != 0) && inTxOptions.isExpired (micros ())) {
+      sendStatus = kDeadlineExpired ;
+      mStaleMessageCount += 1 ;
     }else if (inMessage.idx == 0) { // Send via Tx FIFO ?
       const uint32_t txfqs = mPeripheralPtr->TXFQS ;
-      const uint32_t hardwareTransmitFifoFreeLevel = txfqs & 0x3F ;
-      if ((hardwareTransmitFifoFreeLevel > 0) && mDriverTransmitFIFO.isEmpty ()) {
+      const uint32_t hardwareTransmitFifoFreeLevel = hardwareTxFIFOFreeLevel (txfqs) ;
+      if ((hardwareTransmitFifoFreeLevel > 0) && !mTxBufferReserved && mDriverTransmitFIFO.isEmpty ()) {
         const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
-        writeTxBuffer (inMessage, putIndex) ;
+        writeTxBuffer (inMessage, putIndex, inTxOptions) ;
+        mPeripheralPtr->TXBAR = 1U << putIndex ; // Request transmit
       }else if (!mDriverTransmitFIFO.isFull ()) {
-        mDriverTransmitFIFO.append (inMessage) ;
+        appendToDriverTransmitFIFO (inMessage, inTxOptions) ;
       }else{
         sendStatus = kTransmitBufferOverflow ;
       }
@@ -419,7 +693,8 @@ uint32_t ACANFD_STM32::tryToSendReturnStatusFD (const CANFDMessage & inMessage)
         const uint32_t txBufferIndex = inMessage.idx - 1 ;
         const bool hardwareTxBufferIsEmpty = (mPeripheralPtr->TXBRP & (1U << txBufferIndex)) == 0 ;
         if (hardwareTxBufferIsEmpty) {
-          writeTxBuffer (inMessage, txBufferIndex) ;
+          writeTxBuffer (inMessage, txBufferIndex, inTxOptions) ;
+          mPeripheralPtr->TXBAR = 1U << txBufferIndex ; // Request transmit
         }else{
           sendStatus = kTransmitBufferOverflow ;
         }
@@ -427,13 +702,338 @@ uint32_t ACANFD_STM32::tryToSendReturnStatusFD (const CANFDMessage & inMessage)
         sendStatus = kTransmitBufferIndexTooLarge ;
       }
     }
-  interrupts () ;
+    notifyTxCompletions () ; // Of reused Tx buffer, after transmit request
+  leaveCriticalSection (savedMask) ;
   return sendStatus ;
 }
 
 //------------------------------------------------------------------------------
+// Blocking send. Without wait routine, the try runs in a driver critical
+// section (as tryToSendReturnStatusFD); on overflow, the send buffer is checked
+// again and WFI is executed with PRIMASK set: an interrupt that frees a slot
+// after the check wakes the core (it is served when PRIMASK is restored), so no
+// wake up is missed. In poll mode, poll is called instead of WFI.
+
+uint32_t ACANFD_STM32::sendFD (const CANFDMessage & inMessage,
+                               const uint32_t inTimeoutMicros) {
+  return sendFD (inMessage, ACANFD_STM32_TxOptions (), inTimeoutMicros) ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32::sendFD (const CANFDMessage & inMessage,
+                               const ACANFD_STM32_TxOptions & inTxOptions,
+                               const uint32_t inTimeoutMicros) {
+  const uint32_t start = micros () ;
+  uint32_t sendStatus = 0 ;
+  bool loop = true ;
+  while (loop) {
+    const uint32_t elapsed = micros () - start ;
+    if (mTransmitWaitRoutine != nullptr) {
+      sendStatus = tryToSendReturnStatusFD (inMessage, inTxOptions) ;
+      loop = (sendStatus == kTransmitBufferOverflow) && (elapsed < inTimeoutMicros) ;
+      if (loop) {
+        mTransmitWaitRoutine (inTimeoutMicros - elapsed) ;
+      }
+    }else{
+      sendStatus = tryToSendReturnStatusFD (inMessage, inTxOptions) ;
+      loop = (sendStatus == kTransmitBufferOverflow) && (elapsed < inTimeoutMicros) ;
+      if (loop && mIRQs) {
+        const uint32_t savedPrimask = __get_PRIMASK () ;
+        __disable_irq () ;
+          if (!sendBufferNotFullForIndex (inMessage.idx)) { // Not freed since the try
+            __WFI () ;
+          }
+        __set_PRIMASK (savedPrimask) ;
+      }else if (loop) {
+        poll () ;
+      }
+    }
+  }
+  return sendStatus ;
+}
+
+//------------------------------------------------------------------------------
+// Messages are sent via the Tx FIFO (idx should be 0). Free hardware Tx FIFO
+// elements are filled from a single TXFQS read (in FIFO mode, they follow the
+// put index), and transmission is requested by a single TXBAR write (in Tx
+// Queue mode, one element is filled per TXFQS read). Then remaining messages
+// are appended to the driver transmit FIFO. Expired messages (deadline) are
+// dropped and counted by mStaleMessageCount.
+
+uint32_t ACANFD_STM32::tryToSendBatchFD (const CANFDMessage * inArray,
+                                         const uint32_t inCount,
+                                         const ACANFD_STM32_TxOptions * inTxOptionsArray) {
+  const ACANFD_STM32_TxOptions noTxOptions ;
+  const uint32_t now = (inTxOptionsArray != nullptr) ? micros () : 0 ; // Read once, for deadlines
+  uint32_t sentCount = 0 ;
+  const uint32_t savedMask = enterCriticalSection () ;
+  //--- Write into hardware Tx FIFO only if driver transmit FIFO is empty, for preserving order
+    if (!mTxBufferReserved && mDriverTransmitFIFO.isEmpty ()) {
+      bool loop = true ;
+      while (loop) {
+        const uint32_t txfqs = mPeripheralPtr->TXFQS ;
+        uint32_t freeLevel = hardwareTxFIFOFreeLevel (txfqs) ;
+        uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+        uint32_t txbar = 0 ;
+        while ((freeLevel > 0) && (sentCount < inCount) && isTxFIFOBatchMessage (inArray [sentCount])) {
+          const ACANFD_STM32_TxOptions & txOptions = (inTxOptionsArray == nullptr)
+            ? noTxOptions
+            : inTxOptionsArray [sentCount]
+          ;
+          if (txOptions.isExpired (now)) {
+            mStaleMessageCount += 1 ;
+          }else{
+            writeTxBuffer (inArray [sentCount], putIndex, txOptions) ;
+            txbar |= 1U << putIndex ;
+            const uint32_t nextPutIndex = putIndex + 1 ;
+            putIndex = (nextPutIndex < HARDWARE_TX_FIFO_SIZE) ? nextPutIndex : 0 ;
+            freeLevel -= 1 ;
+          }
+          sentCount += 1 ;
+        }
+        if (txbar != 0) {
+          mPeripheralPtr->TXBAR = txbar ; // Request transmit
+          notifyTxCompletions () ; // Of reused Tx buffers
+        }
+      //--- In Tx Queue mode, next put index is known only after transmit request
+        loop = mTransmitPriorityQueue && (txbar != 0) ;
+      }
+    }
+  //--- Append remaining messages to driver transmit FIFO
+    bool loop = true ;
+    while (loop && (sentCount < inCount)) {
+      const ACANFD_STM32_TxOptions & txOptions = (inTxOptionsArray == nullptr)
+        ? noTxOptions
+        : inTxOptionsArray [sentCount]
+      ;
+      loop = isTxFIFOBatchMessage (inArray [sentCount]) ;
+      if (loop && txOptions.isExpired (now)) {
+        mStaleMessageCount += 1 ;
+      }else if (loop) {
+        loop = appendToDriverTransmitFIFO (inArray [sentCount], txOptions) ;
+      }
+      if (loop) {
+        sentCount += 1 ;
+      }
+    }
+  leaveCriticalSection (savedMask) ;
+  return sentCount ;
+}
 
-void ACANFD_STM32::writeTxBuffer (const CANFDMessage & inMessage, const uint32_t inTxBufferIndex) {
+//------------------------------------------------------------------------------
+// Transmit deadlines
+
+void ACANFD_STM32::dropStaleMessages (void) {
+  const uint32_t now = micros () ;
+  const uint32_t savedMask = enterCriticalSection () ;
+  //--- Driver transmit FIFO
+    mStaleMessageCount += mDriverTransmitFIFO.removeExpired (now) ;
+  //--- Pending hardware Tx buffers
+    const uint32_t pending = mPeripheralPtr->TXBRP & mTxBufferDeadlineMask & ~ mTxBufferCancelRequestMask ;
+    uint32_t cancelMask = 0 ;
+    uint32_t remaining = pending ;
+    while (remaining != 0) {
+      const uint32_t i = uint32_t (__builtin_ctz (remaining)) ;
+      remaining &= remaining - 1 ;
+      if (int32_t (now - mTxBufferDeadlines [i]) >= 0) {
+        cancelMask |= 1U << i ;
+      }
+    }
+    if (cancelMask != 0) {
+      mPeripheralPtr->TXBCR = cancelMask ;
+      mTxBufferCancelRequestMask |= cancelMask ;
+    }
+  //--- Finished cancellations
+    settleTxBufferCancellations (mPeripheralPtr->TXBCF & mTxBufferCancelRequestMask) ;
+  leaveCriticalSection (savedMask) ;
+}
+
+//------------------------------------------------------------------------------
+// A finished cancellation has TXBCF set; TXBTO is also set if the frame has
+// been sent anyway (transmission was in progress)
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32::settleTxBufferCancellations (const uint32_t inFinishedMask) {
+  const uint32_t cancelledMask = inFinishedMask & ~ mPeripheralPtr->TXBTO ;
+  mStaleMessageCount += uint32_t (__builtin_popcount (cancelledMask)) ;
+  mTxBufferCancelRequestMask &= ~ inFinishedMask ;
+  mTxCompletionPendingMask &= ~ cancelledMask ; // No completion callback
+}
+
+//------------------------------------------------------------------------------
+// Transmit completion callbacks: a Tx buffer whose TXBTO bit is set has been
+// sent (TXBTO is reset by next TXBAR write). collectTxCompletions moves its
+// callback to the ready ones, before the Tx buffer is reused. notifyTxCompletions
+// calls ready callbacks: it is called once Tx buffer writes are done and their
+// transmission requested (a callback can send a message). A ready bit is
+// cleared before calling its callback, so that nested calls do not call it again.
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32::collectTxCompletions (const uint32_t inTxBufferMask) {
+  const uint32_t pending = mTxCompletionPendingMask & inTxBufferMask ;
+  if (pending != 0) { // TXBTO is read only if a callback is pending
+    uint32_t completed = mPeripheralPtr->TXBTO & pending ;
+    mTxCompletionPendingMask &= ~ completed ;
+    mTxCompletionReadyMask |= completed ;
+    while (completed != 0) {
+      const uint32_t i = uint32_t (__builtin_ctz (completed)) ;
+      completed &= completed - 1 ;
+      mTxCompletionReadyCallBacks [i] = mTxCompletionCallBacks [i] ;
+      mTxCompletionReadyMarkers [i] = mTxCompletionMarkers [i] ;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32::notifyTxCompletions (void) {
+  while (mTxCompletionReadyMask != 0) {
+    const uint32_t i = uint32_t (__builtin_ctz (mTxCompletionReadyMask)) ;
+    mTxCompletionReadyMask &= ~ (1U << i) ;
+    mTxCompletionReadyCallBacks [i] (i, mTxCompletionReadyMarkers [i]) ;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Zero copy transmit
+
+ACANFD_STM32::TxBufferHandle ACANFD_STM32::reserveTxBuffer (void) {
+  TxBufferHandle handle ;
+  const uint32_t savedMask = enterCriticalSection () ;
+    if (!mTxBufferReserved && mDriverTransmitFIFO.isEmpty ()) {
+      const uint32_t txfqs = mPeripheralPtr->TXFQS ;
+      if (hardwareTxFIFOFreeLevel (txfqs) > 0) {
+        const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+        volatile uint32_t * txBufferPtr = (uint32_t *) (mRamBaseAddress + 0x278) ;
+        txBufferPtr += putIndex * WORD_COUNT_FOR_PAYLOAD_64_BYTES ;
+        handle.mPayload = txBufferPtr + 2 ;
+        handle.mTxBufferIndex = putIndex ;
+        handle.mPayloadCapacity = 64 ;
+        mTxBufferReserved = true ;
+        const uint32_t txBufferMask = 1U << putIndex ;
+        if ((mTxBufferCancelRequestMask & txBufferMask) != 0) {
+          settleTxBufferCancellations (txBufferMask) ;
+        }
+        mTxBufferDeadlineMask &= ~ txBufferMask ; // No deadline
+        collectTxCompletions (txBufferMask) ;
+        mTxCompletionPendingMask &= ~ txBufferMask ; // No completion callback
+        notifyTxCompletions () ; // Element is reserved: a callback cannot use it
+      }
+    }
+  leaveCriticalSection (savedMask) ;
+  return handle ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::commitTxBuffer (const TxBufferHandle & inHandle,
+                                   const uint32_t inIdentifier,
+                                   const uint8_t inLength,
+                                   const CANFDMessage::Type inType,
+                                   const bool inExtended) {
+//--- Length code
+  static const uint8_t CANFD_LENGTH_FROM_CODE [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+  uint32_t lengthCode = 0 ;
+  while ((lengthCode < 16) && (CANFD_LENGTH_FROM_CODE [lengthCode] != inLength)) {
+    lengthCode += 1 ;
+  }
+  const bool canfd = (inType == CANFDMessage::CANFD_NO_BIT_RATE_SWITCH)
+                  || (inType == CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH) ;
+  const bool ok = mTxBufferReserved
+    && inHandle.isValid ()
+    && (lengthCode < (canfd ? 16U : 9U))
+    && (inLength <= inHandle.mPayloadCapacity)
+  ;
+  if (ok) {
+  //--- Identifier and extended bit
+    uint32_t element0 ;
+    if (inExtended) {
+      element0 = (inIdentifier & 0x1FFFFFFFU) | (1U << 30) ;
+    }else{
+      element0 = (inIdentifier & 0x7FFU) << 18 ;
+    }
+  //--- Control
+    uint32_t element1 = lengthCode << 16 ;
+    if (mDriverTxEventFIFO.size () > 0) {
+      element1 |= 1U << 23 ; // EFC: store Tx event
+    }
+    switch (inType) {
+    case CANFDMessage::CAN_REMOTE :
+      element0 |= 1 << 29 ; // Set RTR bit
+      break ;
+    case CANFDMessage::CAN_DATA :
+      break ;
+    case CANFDMessage::CANFD_NO_BIT_RATE_SWITCH :
+      element1 |= 1 << 21 ; // Set FDF bit
+      break ;
+    case CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH :
+      element1 |= (1 << 21) | (1 << 20) ; // Set FDF and BRS bits
+      break ;
+    }
+    inHandle.mPayload [-2] = element0 ;
+    inHandle.mPayload [-1] = element1 ;
+  //--- Request transmit, and send messages queued while element was reserved
+    const uint32_t savedMask = enterCriticalSection () ;
+      mPeripheralPtr->TXBAR = 1U << inHandle.mTxBufferIndex ;
+      mTxBufferReserved = false ;
+      fillHardwareTxFIFO () ;
+    leaveCriticalSection (savedMask) ;
+  }
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32::cancelTxBuffer (void) {
+  const uint32_t savedMask = enterCriticalSection () ;
+    mTxBufferReserved = false ;
+    fillHardwareTxFIFO () ;
+  leaveCriticalSection (savedMask) ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::availableTxEvent (void) const {
+  const bool hasEvent = mDriverTxEventFIFO.count () > 0 ;
+  return hasEvent ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32::receiveTxEvent (ACANFD_STM32_TxEvent & outEvent) {
+  const bool hasEvent = mDriverTxEventFIFO.remove (outEvent) ;
+  return hasEvent ;
+}
+
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32::writeTxBuffer (const CANFDMessage & inMessage,
+                                  const uint32_t inTxBufferIndex,
+                                  const ACANFD_STM32_TxOptions & inTxOptions) {
+//--- Deadline: settle a previous cancellation (TXBCF and TXBTO are reset by TXBAR)
+  const uint32_t txBufferMask = 1U << inTxBufferIndex ;
+  if ((mTxBufferCancelRequestMask & txBufferMask) != 0) {
+    settleTxBufferCancellations (txBufferMask) ;
+  }
+  mTxBufferDeadlines [inTxBufferIndex] = inTxOptions.mDeadline ;
+  if (inTxOptions.mDeadline != 0) {
+    mTxBufferDeadlineMask |= txBufferMask ;
+  }else{
+    mTxBufferDeadlineMask &= ~ txBufferMask ;
+  }
+//--- Completion callback: previous message of this buffer is collected first,
+//    it is notified by caller (notifyTxCompletions) once transmit is requested
+  collectTxCompletions (txBufferMask) ;
+  if (inTxOptions.mCallBack != nullptr) {
+    mTxCompletionCallBacks [inTxBufferIndex] = inTxOptions.mCallBack ;
+    mTxCompletionMarkers [inTxBufferIndex] = inTxOptions.mMarker ;
+    mTxCompletionPendingMask |= txBufferMask ;
+  }else{
+    mTxCompletionPendingMask &= ~ txBufferMask ;
+  }
 //--- Compute Tx Buffer address
   volatile uint32_t * txBufferPtr = (uint32_t *) (mRamBaseAddress + 0x278) ;
   txBufferPtr += inTxBufferIndex * WORD_COUNT_FOR_PAYLOAD_64_BYTES ;
@@ -464,6 +1064,10 @@ void ACANFD_STM32::writeTxBuffer (const CANFDMessage & inMessage, const uint32_t
     lengthCode = inMessage.len ;
   }
   uint32_t element1 = uint32_t (lengthCode) << 16 ;
+  element1 |= uint32_t (inTxOptions.mMarker) << 24 ; // Message marker
+  if (mDriverTxEventFIFO.size () > 0) {
+    element1 |= 1U << 23 ; // EFC: store Tx event
+  }
 //---
   switch (inMessage.type) {
   case CANFDMessage::CAN_REMOTE :
@@ -492,14 +1096,13 @@ void ACANFD_STM32::writeTxBuffer (const CANFDMessage & inMessage, const uint32_t
   }
   txBufferPtr [0] = element0 ;
   txBufferPtr [1] = element1 ;
-//---Request transmit
-  mPeripheralPtr->TXBAR = 1U << inTxBufferIndex ;
 }
 
 //------------------------------------------------------------------------------
 //   INTERRUPT SERVICE ROUTINES
 //------------------------------------------------------------------------------
 
+ACANFD_STM32_FAST_CODE
 static void getMessageFrom (const uint32_t * inMessageRamAddress,
                             CANFDMessage & outMessage) {
   const uint32_t w0 = inMessageRamAddress [0] ;
@@ -541,33 +1144,188 @@ static void getMessageFrom (const uint32_t * inMessageRamAddress,
 
 //------------------------------------------------------------------------------
 
+ACANFD_STM32_FAST_CODE
+static void getTxEventFrom (const uint32_t * inEventRamAddress,
+                            ACANFD_STM32_TxEvent & outEvent) {
+  const uint32_t e0 = inEventRamAddress [0] ;
+  outEvent.ext = (e0 & (1 << 30)) != 0 ;
+  outEvent.id = outEvent.ext ? (e0 & 0x1FFFFFFF) : ((e0 >> 18) & 0x7FF) ;
+  const bool remote = (e0 & (1 << 29)) != 0 ;
+  const uint32_t e1 = inEventRamAddress [1] ;
+  outEvent.timeStamp = uint16_t (e1) ; // TXTS
+  static const uint8_t CANFD_LENGTH_FROM_CODE [16] = {0, 1, 2, 3, 4, 5, 6, 7, 8, 12, 16, 20, 24, 32, 48, 64} ;
+  outEvent.len = CANFD_LENGTH_FROM_CODE [(e1 >> 16) & 0xF] ;
+  const bool fdf = (e1 & (1 << 21)) != 0 ;
+  const bool brs = (e1 & (1 << 20)) != 0 ;
+  if (fdf) { // CANFD frame
+    outEvent.type = brs ? CANFDMessage::CANFD_WITH_BIT_RATE_SWITCH : CANFDMessage::CANFD_NO_BIT_RATE_SWITCH ;
+  }else if (remote) {
+    outEvent.type = CANFDMessage::CAN_REMOTE ;
+  }else{
+    outEvent.type = CANFDMessage::CAN_DATA ;
+  }
+  outEvent.marker = uint8_t (e1 >> 24) ; // MM
+}
+
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32::getTxEvents (void) {
+  bool loop = mDriverTxEventFIFO.size () > 0 ;
+  while (loop) {
+    const uint32_t txefs = mPeripheralPtr->TXEFS ;
+    loop = (txefs & 0x7U) > 0 ; // Fill level
+    if (loop) {
+    //--- Get index
+      const uint32_t getIndex = (txefs >> 8) & 0x3 ;
+    //--- Compute event RAM address
+      const uint32_t * address = (uint32_t *) (mRamBaseAddress + 0x0260) ;
+      address += getIndex * 2 ;
+    //--- Decode event directly into driver Tx event FIFO
+      ACANFD_STM32_TxEvent * eventPtr = mDriverTxEventFIFO.reserve () ;
+      if (eventPtr != nullptr) {
+        getTxEventFrom (address, *eventPtr) ;
+        mDriverTxEventFIFO.commit () ;
+      }
+    //--- Acknowledge event
+      mPeripheralPtr->TXEFA = getIndex ;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
 void ACANFD_STM32::isr0 (void) {
 //--- Interrupt Acknowledge
-  mPeripheralPtr->IR = FDCAN_IR_TC ;
+  mPeripheralPtr->IR = FDCAN_IR_TC | FDCAN_IR_TEFN ;
+//--- Transmit completion callbacks
+  collectTxCompletions (~ 0U) ;
+  notifyTxCompletions () ;
 //--- Write message into transmit fifo ?
-  bool writeMessage = true ;
-  CANFDMessage message ;
-  while (writeMessage) {
+  fillHardwareTxFIFO () ;
+//--- Get Tx events
+  getTxEvents () ;
+//--- Wake up blocked sendFD
+  if (mTransmitSignalRoutine != nullptr) {
+    mTransmitSignalRoutine () ;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Move messages from driver transmit FIFO to free hardware Tx FIFO elements
+// (not while a hardware Tx FIFO element is reserved by reserveTxBuffer).
+// As in tryToSendBatchFD, TXFQS is read once: free elements follow the put
+// index, and transmission is requested by a single TXBAR write (in Tx Queue
+// mode, one element is filled per TXFQS read).
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32::fillHardwareTxFIFO (void) {
+  bool loop = !mTxBufferReserved && !mDriverTransmitFIFO.isEmpty () ;
+  uint32_t now = 0 ; // micros () runs from flash: read once, on the first deadline
+  bool nowIsValid = false ;
+  ACANFD_STM32_UninitializedMessage messageStorage ;
+  CANFDMessage & message = messageStorage.message () ;
+  ACANFD_STM32_TxOptions txOptions ;
+  while (loop) {
     const uint32_t txfqs = mPeripheralPtr->TXFQS ;
-    const uint32_t txFifoFreeLevel = txfqs & 0x3F ;
-    if ((txFifoFreeLevel > 0) && mDriverTransmitFIFO.remove (message)) {
-      const uint32_t putIndex = (txfqs >> 16) & 0x1F ;
-      writeTxBuffer (message, putIndex) ;
-    }else{
-      writeMessage = false ;
+    uint32_t freeLevel = hardwareTxFIFOFreeLevel (txfqs) ;
+    uint32_t putIndex = (txfqs >> 16) & 0x1F ;
+    uint32_t txbar = 0 ;
+    while ((freeLevel > 0) && mDriverTransmitFIFO.remove (message, txOptions)) {
+      if ((txOptions.mDeadline != 0) && !nowIsValid) {
+        now = micros () ;
+        nowIsValid = true ;
+      }
+      if (txOptions.isExpired (now)) {
+        mStaleMessageCount += 1 ;
+      }else{
+        writeTxBuffer (message, putIndex, txOptions) ;
+        txbar |= 1U << putIndex ;
+        const uint32_t nextPutIndex = putIndex + 1 ;
+        putIndex = (nextPutIndex < HARDWARE_TX_FIFO_SIZE) ? nextPutIndex : 0 ;
+        freeLevel -= 1 ;
+      }
+    }
+    if (txbar != 0) {
+      mPeripheralPtr->TXBAR = txbar ; // Request transmit
+      notifyTxCompletions () ; // Of reused Tx buffers
     }
+  //--- In Tx Queue mode, next put index is known only after transmit request
+    loop = mTransmitPriorityQueue && (txbar != 0) ;
   }
 }
 
 //------------------------------------------------------------------------------
 
+ACANFD_STM32_FAST_CODE
 void ACANFD_STM32::isr1 (void) {
 //--- Interrupt Acknowledge
   const uint32_t it = mPeripheralPtr->IR ;
   const uint32_t ack = it & (FDCAN_IR_RF0N | FDCAN_IR_RF1N) ;
   mPeripheralPtr->IR = ack ;
-//--- Get messages
-  CANFDMessage message ;
+//--- Get messages, if not deferred (an already pending interrupt can occur)
+  if (!mDeferredReceivePending) {
+    const bool remaining = getReceivedMessages (mReceiveFrameBudget) ;
+  //--- Budget exhausted: remaining messages are handled later
+    if (remaining && mIRQs) {
+      if (mDeferredReceiveIRQ) { // By deferredReceive; until then, isr1 is disabled
+        mDeferredReceivePending = true ;
+        mPeripheralPtr->IE &= ~ mReceiveInterruptMask ;
+        if (mDeferredReceiveIRQ.value () == PendSV_IRQn) {
+          SCB->ICSR = SCB_ICSR_PENDSVSET_Msk ;
+        }else{
+          NVIC_SetPendingIRQ (mDeferredReceiveIRQ.value ()) ;
+        }
+      }else{ // By isr1, after pending interrupts with same or higher priority
+        NVIC_SetPendingIRQ (mIRQs.value ().mIRQ1) ;
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32::deferredReceive (void) {
+  if (mDeferredReceivePending) {
+    getReceivedMessages (0) ;
+    mDeferredReceivePending = false ;
+    mPeripheralPtr->IE |= mReceiveInterruptMask ;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Decode message into latest value cache if its identifier is cached, returns
+// true if message has been stored
+
+ACANFD_STM32_FAST_CODE
+bool ACANFD_STM32::storeIntoLatestValueCache (const uint32_t * inMessageRamAddress) {
+  bool stored = false ;
+  if (mLatestValueCache != nullptr) {
+    const uint32_t w0 = inMessageRamAddress [0] ;
+    const bool extended = (w0 & (1 << 30)) != 0 ;
+    const uint32_t identifier = extended ? (w0 & 0x1FFFFFFF) : ((w0 >> 18) & 0x7FF) ;
+    const uint16_t entryIndex = mLatestValueCache->entryIndexForKey (
+      ACANFD_STM32_LatestValueCache::keyFor (extended, identifier)
+    ) ;
+    stored = entryIndex != ACANFD_STM32_LatestValueCache::kNoEntry ;
+    if (stored) {
+      CANFDMessage * messagePtr = mLatestValueCache->beginWrite (entryIndex) ;
+      getMessageFrom (inMessageRamAddress, *messagePtr) ;
+      mLatestValueCache->endWrite (entryIndex) ;
+    }
+  }
+  return stored ;
+}
+
+//------------------------------------------------------------------------------
+// Get at most inMaxCount messages from hardware Rx FIFOs (0: no limit), returns
+// true if the limit is reached (hardware Rx FIFOs may be not empty)
+
+ACANFD_STM32_FAST_CODE
+bool ACANFD_STM32::getReceivedMessages (const uint32_t inMaxCount) {
+  uint32_t count = 0 ;
+  bool limitReached = false ;
   bool loop = true ;
   while (loop) {
   //--- Get from FIFO 0
@@ -579,12 +1337,16 @@ void ACANFD_STM32::isr1 (void) {
     //--- Compute message RAM address
       const uint32_t * address = (uint32_t *) (mRamBaseAddress + 0x00B0) ;
       address += readIndex * WORD_COUNT_FOR_PAYLOAD_64_BYTES ;
-    //--- Get message
-      getMessageFrom (address, message) ;
+    //--- Decode message directly into latest value cache, or driver receive buffer 0
+      if (!storeIntoLatestValueCache (address)) {
+        CANFDMessage * messagePtr = mDriverReceiveFIFO0.reserve () ;
+        if (messagePtr != nullptr) {
+          getMessageFrom (address, *messagePtr) ;
+          mDriverReceiveFIFO0.commit (uint16_t (address [1])) ; // RXTS
+        }
+      }
     //--- Clear receive flag
       mPeripheralPtr->RXF0A = readIndex ;
-    //--- Enter message into driver receive buffer 0
-      mDriverReceiveFIFO0.append (message) ;
     }
   //--- Get from FIFO 1
     const uint32_t rxf1s = mPeripheralPtr->RXF1S ;
@@ -595,16 +1357,23 @@ void ACANFD_STM32::isr1 (void) {
     //--- Compute message RAM address
       const uint32_t * address = (uint32_t *) (mRamBaseAddress + 0x0188) ;
       address += readIndex * WORD_COUNT_FOR_PAYLOAD_64_BYTES ;
-    //--- Get message
-      getMessageFrom (address, message) ;
+    //--- Decode message directly into latest value cache, or driver receive buffer 1
+      if (!storeIntoLatestValueCache (address)) {
+        CANFDMessage * messagePtr = mDriverReceiveFIFO1.reserve () ;
+        if (messagePtr != nullptr) {
+          getMessageFrom (address, *messagePtr) ;
+          mDriverReceiveFIFO1.commit (uint16_t (address [1])) ; // RXTS
+        }
+      }
     //--- Clear receive flag
       mPeripheralPtr->RXF1A = readIndex ;
-    //--- Enter message into driver receive buffer 1
-      mDriverReceiveFIFO1.append (message) ;
     }
   //--- Loop ?
-    loop = fifo0NotEmpty || fifo1NotEmpty ;
+    count += fifo0NotEmpty + fifo1NotEmpty ;
+    limitReached = (inMaxCount > 0) && (count >= inMaxCount) ;
+    loop = (fifo0NotEmpty || fifo1NotEmpty) && !limitReached ;
   }
+  return limitReached ;
 }
 
 //------------------------------------------------------------------------------
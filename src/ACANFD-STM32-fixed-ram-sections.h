@@ -8,7 +8,10 @@
 
 #include <ACANFD_STM32_Settings.h>
 #include <ACANFD_STM32_FIFO.h>
+#include <ACANFD_STM32_TxEventFIFO.h>
 #include <ACANFD_STM32_CANFDMessage.h>
+#include <ACANFD_STM32_CriticalSection.h>
+#include <ACANFD_STM32_FastMemory.h>
 
 #include <optional>
 
@@ -75,14 +78,24 @@ class ACANFD_STM32 {
 //-------------------- begin; returns a result code :
 //  0 : Ok
 //  other: every bit denotes an error
+//  kIncompleteDriverTransmitFIFOStorage: mDriverTransmitFIFOStorage is set, but
+//  mDriverTransmitFIFOTxOptionsStorage or mDriverTransmitFIFOSlotOrderStorage is
+//  nullptr (transmit options and priority insertion would be lost)
+//  kDriverReceiveFIFOMaxPayloadTooSmall: mDriverReceiveFIFO0MaxPayload or
+//  mDriverReceiveFIFO1MaxPayload is lower than 64, the payload of hardware Rx
+//  FIFO elements (longer received frames would be dropped)
+  public: static const uint32_t kInvalidTimeStampPrescaler             = 1 << 18 ;
+  public: static const uint32_t kIRQPriorityTooLarge                   = 1 << 19 ;
   public: static const uint32_t kMessageRamAllocatedSizeTooSmall       = 1 << 20 ;
   public: static const uint32_t kMessageRamOverflow                    = 1 << 21 ;
   public: static const uint32_t kHardwareRxFIFO0SizeGreaterThan64      = 1 << 22 ;
   public: static const uint32_t kHardwareTransmitFIFOSizeGreaterThan32 = 1 << 23 ;
   public: static const uint32_t kDedicacedTransmitTxBufferCountGreaterThan30 = 1 << 24 ;
   public: static const uint32_t kTxBufferCountGreaterThan32            = 1 << 25 ;
-  public: static const uint32_t kHardwareTransmitFIFOSizeEqualToZero   = 1 << 26 ;
-  public: static const uint32_t kHardwareRxFIFO1SizeGreaterThan64      = 1 << 27 ;
+  public: static const uint32_t kHardwareTransmitFIFOSizeEqualToZero   = kHardwareTransmitFIFOSizeGreaterThan32 ; // Size not in 1 ... 32
+  public: static const uint32_t kIncompleteDriverTransmitFIFOStorage   = 1 << 26 ;
+  public: static const uint32_t kHardwareRxFIFO1SizeGreaterThan64      = kHardwareRxFIFO0SizeGreaterThan64 ; // Size not in 0 ... 64
+  public: static const uint32_t kDriverReceiveFIFOMaxPayloadTooSmall   = 1 << 27 ;
   public: static const uint32_t kTooManyStandardFilters                = 1 << 28 ;
   public: static const uint32_t kTooManyExtendedFilters                = 1 << 29 ;
   public: static const uint32_t kInvalidTxPin                          = 1 << 30 ;
@@ -106,23 +119,155 @@ class ACANFD_STM32 {
   public: static const uint32_t kInvalidMessage              = 1 ;
   public: static const uint32_t kTransmitBufferIndexTooLarge = 2 ;
   public: static const uint32_t kTransmitBufferOverflow      = 3 ;
+  public: static const uint32_t kDeadlineExpired             = 4 ;
+
+//--- Transmitting with transmit options (see ACANFD_STM32_TxOptions, they are
+//    stored by the driver, not in CANFDMessage). mCallBack is called when the
+//    message has been sent (TXBTO bit set), with the hardware Tx buffer index
+//    and mMarker. It runs from isr0, or from a transmit method (FDCAN
+//    interrupts being masked) if the Tx buffer is reused before isr0 runs: it is
+//    then called once the new message has been written and its transmission
+//    requested, so it may send messages. It is not called if the message is
+//    dropped or cancelled (deadline).
+  public: uint32_t tryToSendReturnStatusFD (const CANFDMessage & inMessage,
+                                            const ACANFD_STM32_TxOptions & inTxOptions) ;
+
+  public: uint32_t tryToSendReturnStatusFD (const CANFDMessage & inMessage,
+                                            const ACANFDTxCompletionCallBack inCallBack) ;
+
+//--- Blocking send: sleeps until the message is enqueued, at most inTimeoutMicros
+//    (see ACANFD_STM32_Settings::mTransmitWaitRoutine); returns the
+//    tryToSendReturnStatusFD status (kTransmitBufferOverflow on timeout).
+//    Call it from thread mode, with interrupts enabled.
+  public: uint32_t sendFD (const CANFDMessage & inMessage, const uint32_t inTimeoutMicros) ;
+
+  public: uint32_t sendFD (const CANFDMessage & inMessage,
+                           const ACANFD_STM32_TxOptions & inTxOptions,
+                           const uint32_t inTimeoutMicros) ;
+
+//--- Transmitting an array of messages via the Tx FIFO; returns the number of
+//    accepted messages (stops at the first invalid message, message with a non
+//    zero idx, or when driver transmit FIFO is full). inTxOptionsArray, if not
+//    nullptr, provides the transmit options of every message (inCount elements):
+//    expired messages are dropped (see staleMessageCount), they count as accepted.
+  public: uint32_t tryToSendBatchFD (const CANFDMessage * inArray,
+                                     const uint32_t inCount,
+                                     const ACANFD_STM32_TxOptions * inTxOptionsArray = nullptr) ;
 
   public: inline uint32_t transmitFIFOSize (void) const { return mDriverTransmitFIFO.size () ; }
   public: inline uint32_t transmitFIFOCount (void) const { return mDriverTransmitFIFO.count () ; }
   public: inline uint32_t transmitFIFOPeakCount (void) const { return mDriverTransmitFIFO.peakCount () ; }
 
-//--- Receiving messages
+//--- Transmit deadlines (ACANFD_STM32_TxOptions::mDeadline): an expired message is not
+//    accepted by tryToSendReturnStatusFD (kDeadlineExpired), and is dropped
+//    when it leaves the driver transmit FIFO. dropStaleMessages, that should be
+//    called periodically, removes expired messages from the driver transmit FIFO,
+//    and requests cancellation of pending hardware Tx buffers whose deadline is
+//    expired (TXBCR). Dropped messages, and hardware buffers whose cancellation
+//    is confirmed (TXBCF set, TXBTO not set) are counted by staleMessageCount.
+  public: void dropStaleMessages (void) ;
+  public: inline uint32_t staleMessageCount (void) const { return mStaleMessageCount ; }
+
+//--- Zero copy transmit via the Tx FIFO: reserveTxBuffer returns a handle on the
+//    next free hardware Tx FIFO element (an invalid handle if none is free, if the
+//    driver transmit FIFO is not empty, or if an element is already reserved).
+//    The payload is written in place, by 32-bit words; then commitTxBuffer writes
+//    the element header and requests transmission (it returns false if length
+//    is invalid for type, or greater than payload capacity: element remains
+//    reserved). While an element is reserved, other Tx FIFO messages are queued in
+//    the driver transmit FIFO. cancelTxBuffer releases the element without sending.
+  public: class TxBufferHandle {
+    public: volatile uint32_t * mPayload = nullptr ; // In message RAM
+    public: uint32_t mTxBufferIndex = 0 ;
+    public: uint32_t mPayloadCapacity = 0 ; // In bytes
+    public: inline bool isValid (void) const { return mPayload != nullptr ; }
+  } ;
+  public: TxBufferHandle reserveTxBuffer (void) ;
+  public: bool commitTxBuffer (const TxBufferHandle & inHandle,
+                              const uint32_t inIdentifier,
+                              const uint8_t inLength,
+                              const CANFDMessage::Type inType,
+                              const bool inExtended = false) ;
+  public: void cancelTxBuffer (void) ;
+
+//--- Tx events (see ACANFD_STM32_Settings::mDriverTxEventFIFOSize): they are
+//    appended by isr0 to the driver Tx event FIFO (single producer / single consumer);
+//    when it is full, new events are dropped and counted
+  public: bool availableTxEvent (void) const ;
+  public: bool receiveTxEvent (ACANFD_STM32_TxEvent & outEvent) ;
+  public: inline uint32_t driverTxEventFIFOSize (void) const { return mDriverTxEventFIFO.size () ; }
+  public: inline uint32_t driverTxEventFIFOPeakCount (void) const { return mDriverTxEventFIFO.peakCount () ; }
+  public: inline uint32_t driverTxEventFIFODroppedCount (void) const { return mDriverTxEventFIFO.droppedCount () ; }
+
+//--- Receiving messages (driver receive FIFOs are lock free single producer /
+//    single consumer rings: call these methods from a single context)
   public: bool availableFD0 (void) ;
   public: bool receiveFD0 (CANFDMessage & outMessage) ;
+  public: bool receiveFD0 (CANFDMessage & outMessage, uint16_t & outTimeStamp) ;
   public: bool availableFD1 (void) ;
   public: bool receiveFD1 (CANFDMessage & outMessage) ;
+  public: bool receiveFD1 (CANFDMessage & outMessage, uint16_t & outTimeStamp) ;
   public: bool dispatchReceivedMessage (void) ;
   public: bool dispatchReceivedMessageFIFO0 (void) ;
   public: bool dispatchReceivedMessageFIFO1 (void) ;
 
+//--- Receiving messages by batch: at most inMaxCount messages are moved out of
+//    driver receive FIFO(s) in a single pass; returns the number of messages
+//    written in outArray. receiveFDBatch empties FIFO 0 first. If not nullptr,
+//    outTimeStamps receives the time stamp of every returned message.
+  public: uint32_t receiveFD0Batch (CANFDMessage * outArray,
+                                    const uint32_t inMaxCount,
+                                    uint16_t * outTimeStamps = nullptr) ;
+  public: uint32_t receiveFD1Batch (CANFDMessage * outArray,
+                                    const uint32_t inMaxCount,
+                                    uint16_t * outTimeStamps = nullptr) ;
+  public: uint32_t receiveFDBatch (CANFDMessage * outArray,
+                                   const uint32_t inMaxCount,
+                                   uint16_t * outTimeStamps = nullptr) ;
+//    ioWorkArray is used as storage for received messages before dispatching;
+//    returns the number of dispatched messages
+  public: uint32_t dispatchReceivedMessageBatch (CANFDMessage * ioWorkArray, const uint32_t inMaxCount) ;
+
+//--- Zero copy reception: peekFD0 returns a pointer to the oldest message of
+//    driver receive FIFO 0 (nullptr if empty), it is valid until releaseFD0
+//    is called. releaseFD0 frees the slot (returns false if FIFO is empty).
+//    If not nullptr, outTimeStampPtr receives the message time stamp.
+  public: const CANFDMessage * peekFD0 (uint16_t * outTimeStampPtr = nullptr) ;
+  public: bool releaseFD0 (void) ;
+  public: const CANFDMessage * peekFD1 (uint16_t * outTimeStampPtr = nullptr) ;
+  public: bool releaseFD1 (void) ;
+
 //--- Driver Transmit buffer
   protected: ACANFD_STM32_FIFO mDriverTransmitFIFO ;
 
+//--- Transmit priority queue (Tx Queue mode, driver transmit FIFO ordered by priority)
+  protected: bool mTransmitPriorityQueue = false ;
+
+//--- Blocking send wait / signal routines (nullptr: WFI)
+  protected: void (*mTransmitWaitRoutine) (const uint32_t inTimeoutMicros) = nullptr ;
+  protected: void (*mTransmitSignalRoutine) (void) = nullptr ;
+
+//--- A hardware Tx FIFO element is reserved by reserveTxBuffer
+  protected: volatile bool mTxBufferReserved = false ;
+
+//--- Transmit deadlines of hardware Tx buffers
+  protected: uint32_t mTxBufferDeadlines [32] ;
+  protected: uint32_t mTxBufferDeadlineMask = 0 ; // Tx buffers with a deadline
+  protected: uint32_t mTxBufferCancelRequestMask = 0 ; // Cancellation requested, not settled
+  protected: volatile uint32_t mStaleMessageCount = 0 ;
+
+//--- Transmit completion callbacks of hardware Tx buffers
+  protected: ACANFDTxCompletionCallBack mTxCompletionCallBacks [32] ;
+  protected: uint8_t mTxCompletionMarkers [32] ;
+  protected: uint32_t mTxCompletionPendingMask = 0 ; // Tx buffers with a callback, not yet sent
+//    Callbacks of sent messages, called once the new message of the Tx buffer is written
+  protected: ACANFDTxCompletionCallBack mTxCompletionReadyCallBacks [32] ;
+  protected: uint8_t mTxCompletionReadyMarkers [32] ;
+  protected: uint32_t mTxCompletionReadyMask = 0 ;
+
+//--- Driver Tx event FIFO
+  protected: ACANFD_STM32_TxEventFIFO mDriverTxEventFIFO ;
+
 //--- Poll
   public: void poll (void) ;
 
@@ -131,6 +276,8 @@ class ACANFD_STM32 {
   public: uint32_t driverReceiveFIFO0Size (void) { return mDriverReceiveFIFO0.size () ; }
   public: uint32_t driverReceiveFIFO0Count (void) { return mDriverReceiveFIFO0.count () ; }
   public: uint32_t driverReceiveFIFO0PeakCount (void) { return mDriverReceiveFIFO0.peakCount () ; }
+  public: uint32_t driverReceiveFIFO0DroppedCount (void) const { return mDriverReceiveFIFO0.droppedCount () ; }
+  public: uint32_t driverReceiveFIFO0PayloadDroppedCount (void) const { return mDriverReceiveFIFO0.payloadDroppedCount () ; }
   public: void resetDriverReceiveFIFO0PeakCount (void) { mDriverReceiveFIFO0.resetPeakCount () ; }
 
 //--- Driver receive FIFO 1
@@ -138,6 +285,8 @@ class ACANFD_STM32 {
   public: uint32_t driverReceiveFIFO1Size (void) { return mDriverReceiveFIFO1.size () ; }
   public: uint32_t driverReceiveFIFO1Count (void) { return mDriverReceiveFIFO1.count () ; }
   public: uint32_t driverReceiveFIFO1PeakCount (void) { return mDriverReceiveFIFO1.peakCount () ; }
+  public: uint32_t driverReceiveFIFO1DroppedCount (void) const { return mDriverReceiveFIFO1.droppedCount () ; }
+  public: uint32_t driverReceiveFIFO1PayloadDroppedCount (void) const { return mDriverReceiveFIFO1.payloadDroppedCount () ; }
   public: void resetDriverReceiveFIFO1PeakCount (void) { mDriverReceiveFIFO1.resetPeakCount () ; }
 
 
@@ -154,12 +303,66 @@ class ACANFD_STM32 {
   protected: ACANFDCallBackRoutine mNonMatchingStandardMessageCallBack = nullptr ;
   protected: ACANFDCallBackRoutine mNonMatchingExtendedMessageCallBack = nullptr ;
 
+//--- Actual NVIC priority of FDCAN interrupts (the highest one of IRQ0 and IRQ1,
+//    0 in poll mode), set by beginFD
+  protected: uint8_t mIRQPriority = 0 ;
+  public: inline uint8_t irqPriority (void) const { return mIRQPriority ; }
+
+//--- Critical sections (mask FDCAN interrupts)
+  protected: uint32_t mCriticalSectionBasePriority = 0 ;
+  protected: inline uint32_t enterCriticalSection (void) const {
+    return ACANFD_STM32_CriticalSection::enter (mCriticalSectionBasePriority) ;
+  }
+  protected: inline void leaveCriticalSection (const uint32_t inSavedMask) const {
+    ACANFD_STM32_CriticalSection::leave (mCriticalSectionBasePriority, inSavedMask) ;
+  }
+
 //--- Internal methods
   public: void isr0 (void) ;
   public: void isr1 (void) ;
+  public: void deferredReceive (void) ;
+  private: bool getReceivedMessages (const uint32_t inMaxCount) ;
+  private: void getTxEvents (void) ;
+  private: void fillHardwareTxFIFO (void) ;
+  private: void settleTxBufferCancellations (const uint32_t inFinishedMask) ;
+  private: void collectTxCompletions (const uint32_t inTxBufferMask) ;
+  private: void notifyTxCompletions (void) ;
+  private: bool storeIntoLatestValueCache (const uint32_t * inMessageRamAddress) ;
   private: void writeTxBuffer (const CANFDMessage & inMessage,
-                               const uint32_t inTxBufferIndex) ;
+                               const uint32_t inTxBufferIndex,
+                               const ACANFD_STM32_TxOptions & inTxOptions = ACANFD_STM32_TxOptions ()) ;
   private: void internalDispatchReceivedMessage (const CANFDMessage & inMessage) ;
+  private: inline uint32_t hardwareTxFIFOFreeLevel (const uint32_t inTXFQS) const {
+    return mTransmitPriorityQueue
+      ? (((inTXFQS & FDCAN_TXFQS_TFQF) == 0) ? 1 : 0) // Tx Queue: free level is not available
+      : (inTXFQS & 0x3F)
+    ;
+  }
+  private: inline bool appendToDriverTransmitFIFO (const CANFDMessage & inMessage,
+                                                   const ACANFD_STM32_TxOptions & inTxOptions = ACANFD_STM32_TxOptions ()) {
+    return mTransmitPriorityQueue
+      ? mDriverTransmitFIFO.insertByPriority (inMessage, inTxOptions)
+      : mDriverTransmitFIFO.append (inMessage, inTxOptions)
+    ;
+  }
+  private: static inline bool isTxFIFOBatchMessage (const CANFDMessage & inMessage) {
+    return inMessage.isValid () && (inMessage.idx == 0) ;
+  }
+
+//--- Latest value cache (nullptr if not used)
+  protected: ACANFD_STM32_LatestValueCache * mLatestValueCache = nullptr ;
+
+//--- Receive interrupt budget and deferred reception
+  protected: uint32_t mReceiveInterruptMask = 0 ; // IE bits for isr1
+  protected: uint16_t mReceiveFrameBudget = 0 ;
+  protected: std::optional <IRQn_Type> mDeferredReceiveIRQ = std::nullopt ;
+  protected: volatile bool mDeferredReceivePending = false ;
+
+//--- Time stamp: frequency of the time stamp counter (0 if unknown), and
+//    conversion of a tick count (difference between two time stamps) to µs
+  protected: uint32_t mTimeStampFrequency = 0 ;
+  public: inline uint32_t timeStampFrequency (void) const { return mTimeStampFrequency ; }
+  public: uint32_t timeStampTicksToMicroseconds (const uint32_t inTicks) const ;
 
 //--- Status Flags (returns 0 if no error)
 //  Bit 0 : hardware RxFIFO 0 overflow
@@ -0,0 +1,62 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+//  Critical sections
+//------------------------------------------------------------------------------
+// On Cortex-M3/M4/M7, a non zero inBasePriority value is written in BASEPRI:
+// only interrupts with a priority lower than or equal to the FDCAN interrupt
+// priority are masked, higher priority interrupts are never delayed.
+// A zero inBasePriority value (FDCAN interrupts not used, or FDCAN interrupt
+// priority is 0), and Cortex-M0+ (no BASEPRI register) fall back to PRIMASK.
+// enter returns the previous mask, that should be given to leave: critical
+// sections can be nested.
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_CriticalSection {
+
+  public: static inline uint32_t basePriorityForIRQPriority (const uint32_t inIRQPriority) {
+    #if (__CORTEX_M == 0U)
+      return 0 ;
+    #else
+      return (inIRQPriority << (8U - __NVIC_PRIO_BITS)) & 0xFFU ;
+    #endif
+  }
+
+  public: static inline uint32_t enter (const uint32_t inBasePriority) {
+    #if (__CORTEX_M == 0U)
+      const uint32_t savedMask = __get_PRIMASK () ;
+      __disable_irq () ;
+    #else
+      uint32_t savedMask ;
+      if (inBasePriority == 0) {
+        savedMask = __get_PRIMASK () ;
+        __disable_irq () ;
+      }else{
+        savedMask = __get_BASEPRI () ;
+        __set_BASEPRI_MAX (inBasePriority) ;
+      }
+    #endif
+    return savedMask ;
+  }
+
+  public: static inline void leave (const uint32_t inBasePriority, const uint32_t inSavedMask) {
+    #if (__CORTEX_M == 0U)
+      __set_PRIMASK (inSavedMask) ;
+    #else
+      if (inBasePriority == 0) {
+        __set_PRIMASK (inSavedMask) ;
+      }else{
+        __set_BASEPRI (inSavedMask) ;
+      }
+    #endif
+  }
+
+} ;
+
+//------------------------------------------------------------------------------
@@ -2,16 +2,29 @@
 
 #include <ACANFD_STM32_FIFO.h>
 
+#include <new>
+
 //------------------------------------------------------------------------------
 // Default constructor
 //------------------------------------------------------------------------------
 
 ACANFD_STM32_FIFO::ACANFD_STM32_FIFO (void) :
+ACANFD_STM32_RingIndexes (),
 mBuffer (nullptr),
-mSize (0),
-mReadIndex (0),
-mCount (0),
-mPeakCount (0) {
+mTxOptions (nullptr),
+mTimeStamps (nullptr),
+mSlotOrder (nullptr),
+mOverwriteOldest (false),
+mOwnsBuffer (true),
+mConsumerBasePriority (0),
+mPackedBuffer (nullptr),
+mPackedReserveMessage (nullptr),
+mPackedPeekMessage (nullptr),
+mPackedWordSize (0),
+mPackedMaxPayload (64),
+mPayloadDroppedCount (0),
+mAppendedCount (0),
+mRemovedCount (0) {
 }
 
 //------------------------------------------------------------------------------
@@ -19,56 +32,476 @@ mPeakCount (0) {
 //------------------------------------------------------------------------------
 
 ACANFD_STM32_FIFO:: ~ ACANFD_STM32_FIFO (void) {
-  delete [] mBuffer ;
+  free () ;
 }
 
 //------------------------------------------------------------------------------
 // initWithSize
 //------------------------------------------------------------------------------
 
-void ACANFD_STM32_FIFO::initWithSize (const uint16_t inSize) {
-  delete [] mBuffer ;
-  mBuffer = new CANFDMessage [inSize] ;
-  mSize = inSize ;
-  mReadIndex = 0 ;
-  mCount = 0 ;
-  mPeakCount = 0 ;
+void ACANFD_STM32_FIFO::initWithSize (const uint16_t inSize,
+                                      const bool inWithTxOptions,
+                                      const bool inWithTimeStamps) {
+  free () ;
+  resetRing (inSize) ;
+  mBuffer = new CANFDMessage [mSize] ;
+  mTxOptions = inWithTxOptions ? new ACANFD_STM32_TxOptions [mSize] : nullptr ;
+  mSlotOrder = inWithTxOptions ? new uint16_t [mSize] : nullptr ;
+  mTimeStamps = inWithTimeStamps ? new uint16_t [mSize] : nullptr ;
+  mOwnsBuffer = true ;
+  if (mSlotOrder != nullptr) {
+    for (uint16_t i=0 ; i<mSize ; i++) {
+      mSlotOrder [i] = i ;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// initWithBuffer
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_FIFO::initWithBuffer (CANFDMessage * inBuffer,
+                                        const uint16_t inSize,
+                                        ACANFD_STM32_TxOptions * inTxOptions,
+                                        uint16_t * inSlotOrder,
+                                        uint16_t * inTimeStamps) {
+  free () ;
+  mBuffer = inBuffer ;
+  mTxOptions = (inSlotOrder != nullptr) ? inTxOptions : nullptr ;
+  mSlotOrder = (inTxOptions != nullptr) ? inSlotOrder : nullptr ;
+  mTimeStamps = inTimeStamps ;
+  mOwnsBuffer = false ;
+  resetRing (inSize) ; // Slots beyond MAX_SIZE are not used
+  if (mSlotOrder != nullptr) {
+    for (uint16_t i=0 ; i<mSize ; i++) {
+      mSlotOrder [i] = i ;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+// initPackedWithSize
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_FIFO::initPackedWithSize (const uint32_t inByteSize,
+                                            const uint8_t inMaxPayload) {
+  const uint32_t maxWordCount = 0xFFFFU + PACKED_STAGING_WORD_COUNT ;
+  const uint32_t wordCount = (inByteSize < (4 * maxWordCount)) ? (inByteSize / 4) : maxWordCount ;
+  initPackedWithBuffer (new uint32_t [wordCount], wordCount, inMaxPayload) ;
+  mOwnsBuffer = true ;
+}
+
+//------------------------------------------------------------------------------
+// initPackedWithBuffer
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_FIFO::initPackedWithBuffer (uint32_t * inBuffer,
+                                              const uint32_t inWordCount,
+                                              const uint8_t inMaxPayload) {
+  free () ;
+  uint32_t ringWordCount = 0 ;
+  if (inWordCount >= PACKED_STAGING_WORD_COUNT) { // Staging messages at the (aligned) end, ring before
+    const uintptr_t stagingAddress =
+      (uintptr_t (inBuffer + inWordCount) - 2 * sizeof (CANFDMessage)) & ~ uintptr_t (alignof (CANFDMessage) - 1) ;
+    CANFDMessage * staging = (CANFDMessage *) stagingAddress ;
+    mPackedReserveMessage = new (& staging [0]) CANFDMessage () ;
+    mPackedPeekMessage = new (& staging [1]) CANFDMessage () ;
+    ringWordCount = uint32_t ((uint32_t *) stagingAddress - inBuffer) ;
+  }
+  mPackedBuffer = inBuffer ;
+  mPackedWordSize = (ringWordCount < 0xFFFFU) ? uint16_t (ringWordCount) : 0xFFFFU ;
+  mPackedMaxPayload = (inMaxPayload < 64) ? inMaxPayload : 64 ;
+  mOwnsBuffer = false ;
+  mSize = (mPackedWordSize > 0) ? ((mPackedWordSize - 1) / 2) : 0 ;
+}
+
+//------------------------------------------------------------------------------
+// Overflow policy
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_FIFO::setOverwriteOldest (const bool inOverwriteOldest,
+                                            const uint32_t inConsumerBasePriority) {
+  mOverwriteOldest = inOverwriteOldest ;
+  mConsumerBasePriority = inConsumerBasePriority ;
 }
 
 //------------------------------------------------------------------------------
 // append
 //------------------------------------------------------------------------------
 
-bool ACANFD_STM32_FIFO::append (const CANFDMessage & inMessage) {
-  const bool ok = mCount < mSize ;
+bool ACANFD_STM32_FIFO::append (const CANFDMessage & inMessage,
+                                const ACANFD_STM32_TxOptions & inTxOptions) {
+  CANFDMessage * slotPtr = reserve () ;
+  bool ok = slotPtr != nullptr ;
   if (ok) {
-    uint16_t writeIndex = mReadIndex + mCount ;
-    if (writeIndex >= mSize) {
-      writeIndex -= mSize ;
+    *slotPtr = inMessage ;
+    if (mTxOptions != nullptr) {
+      mTxOptions [slotPtr - mBuffer] = inTxOptions ;
     }
-    mBuffer [writeIndex] = inMessage ;
-    mCount += 1 ;
-    if (mPeakCount < mCount) {
-      mPeakCount = mCount ;
+    ok = commit () ;
+  }
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Insert by priority
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_FIFO::insertByPriority (const CANFDMessage & inMessage,
+                                          const ACANFD_STM32_TxOptions & inTxOptions) {
+  CANFDMessage * slotPtr = reserve () ;
+  const bool ok = slotPtr != nullptr ;
+  if (ok) {
+    const uint16_t messageSlot = uint16_t (slotPtr - mBuffer) ;
+    *slotPtr = inMessage ;
+    if (mSlotOrder != nullptr) {
+      mTxOptions [messageSlot] = inTxOptions ;
+      const uint32_t key = priorityKey (inMessage) ;
+      const uint16_t readIndex = mReadIndex.load (std::memory_order_acquire) ;
+      uint16_t index = mWriteIndex.load (std::memory_order_relaxed) ;
+    //--- Move slot indexes of lower priority messages one position toward the tail
+      bool loop = index != readIndex ;
+      while (loop) {
+        const uint16_t previous = previousIndex (index) ;
+        loop = priorityKey (mBuffer [mSlotOrder [slotFor (previous)]]) > key ;
+        if (loop) {
+          mSlotOrder [slotFor (index)] = mSlotOrder [slotFor (previous)] ;
+          index = previous ;
+          loop = index != readIndex ;
+        }
+      }
+      mSlotOrder [slotFor (index)] = messageSlot ;
     }
-  }else{
-    mPeakCount = mSize + 1 ;
+    commit () ;
   }
   return ok ;
 }
 
+//------------------------------------------------------------------------------
+// Remove expired messages
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32_FIFO::removeExpired (const uint32_t inNowMicros) {
+  uint32_t removedCount = 0 ;
+  if (mSlotOrder != nullptr) { // Deadlines are stored in transmit options
+    const uint16_t readIndex = mReadIndex.load (std::memory_order_acquire) ;
+    const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+    uint16_t keptIndex = readIndex ;
+    for (uint16_t index = readIndex ; index != writeIndex ; index = nextIndex (index)) {
+      const uint16_t messageSlot = mSlotOrder [slotFor (index)] ;
+      if (mTxOptions [messageSlot].isExpired (inNowMicros)) {
+        removedCount += 1 ;
+      }else{
+        if (keptIndex != index) { // Swap: the slot of a removed message becomes free
+          mSlotOrder [slotFor (index)] = mSlotOrder [slotFor (keptIndex)] ;
+          mSlotOrder [slotFor (keptIndex)] = messageSlot ;
+        }
+        keptIndex = nextIndex (keptIndex) ;
+      }
+    }
+    mWriteIndex.store (keptIndex, std::memory_order_release) ;
+  }
+  return removedCount ;
+}
+
+//------------------------------------------------------------------------------
+// Reserve
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+CANFDMessage * ACANFD_STM32_FIFO::reserve (void) {
+  if (mPackedBuffer != nullptr) { // Overflow is detected by commit
+    if (mPackedReserveMessage == nullptr) { // Storage too small for staging messages
+      recordOverflow () ;
+    }
+    return mPackedReserveMessage ;
+  }
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_acquire) ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_relaxed) ;
+  CANFDMessage * slotPtr = nullptr ;
+  if (countFor (readIndex, writeIndex) < mSize) {
+    slotPtr = & mBuffer [messageSlotFor (writeIndex)] ;
+  }else if (mSize > 0) {
+    recordOverflow () ;
+    if (mOverwriteOldest) { // Drop oldest message, its slot receives the new one
+      mReadIndex.store (nextIndex (readIndex), std::memory_order_release) ;
+      slotPtr = & mBuffer [messageSlotFor (writeIndex)] ;
+    }
+  }
+  return slotPtr ;
+}
+
+//------------------------------------------------------------------------------
+// Commit
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+bool ACANFD_STM32_FIFO::commit (const uint16_t inTimeStamp) {
+  if (mPackedBuffer != nullptr) {
+    return packedCommit (inTimeStamp) ;
+  }
+  const uint16_t currentWriteIndex = mWriteIndex.load (std::memory_order_relaxed) ;
+  if (mTimeStamps != nullptr) {
+    mTimeStamps [messageSlotFor (currentWriteIndex)] = inTimeStamp ;
+  }
+  publishSlot (currentWriteIndex) ;
+  return true ;
+}
+
 //------------------------------------------------------------------------------
 // Remove
 //------------------------------------------------------------------------------
 
 bool ACANFD_STM32_FIFO::remove (CANFDMessage & outMessage) {
-  const bool ok = mCount > 0 ;
+  const uint32_t savedMask = enterConsumerCriticalSection () ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  const bool ok = readIndex != writeIndex ;
+  if (mPackedBuffer != nullptr) {
+    if (ok) {
+      mReadIndex.store (packedRemoveAt (readIndex, & outMessage, nullptr), std::memory_order_release) ;
+    }
+  }else if (ok) {
+    outMessage = mBuffer [messageSlotFor (readIndex)] ;
+    mReadIndex.store (nextIndex (readIndex), std::memory_order_release) ;
+  }
+  leaveConsumerCriticalSection (savedMask) ;
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+bool ACANFD_STM32_FIFO::remove (CANFDMessage & outMessage,
+                                ACANFD_STM32_TxOptions & outTxOptions) {
+  const uint32_t savedMask = enterConsumerCriticalSection () ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  const bool ok = readIndex != writeIndex ;
+  if (mPackedBuffer != nullptr) {
+    if (ok) {
+      outTxOptions = ACANFD_STM32_TxOptions () ;
+      mReadIndex.store (packedRemoveAt (readIndex, & outMessage, nullptr), std::memory_order_release) ;
+    }
+  }else if (ok) {
+    outMessage = mBuffer [messageSlotFor (readIndex)] ;
+    outTxOptions = (mTxOptions != nullptr) ? mTxOptions [messageSlotFor (readIndex)] : ACANFD_STM32_TxOptions () ;
+    mReadIndex.store (nextIndex (readIndex), std::memory_order_release) ;
+  }
+  leaveConsumerCriticalSection (savedMask) ;
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_FIFO::remove (CANFDMessage & outMessage,
+                                uint16_t & outTimeStamp) {
+  const uint32_t savedMask = enterConsumerCriticalSection () ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  const bool ok = readIndex != writeIndex ;
+  if (mPackedBuffer != nullptr) {
+    if (ok) {
+      mReadIndex.store (packedRemoveAt (readIndex, & outMessage, & outTimeStamp), std::memory_order_release) ;
+    }
+  }else if (ok) {
+    outMessage = mBuffer [messageSlotFor (readIndex)] ;
+    outTimeStamp = (mTimeStamps != nullptr) ? mTimeStamps [messageSlotFor (readIndex)] : 0 ;
+    mReadIndex.store (nextIndex (readIndex), std::memory_order_release) ;
+  }
+  leaveConsumerCriticalSection (savedMask) ;
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Remove array
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32_FIFO::removeArray (CANFDMessage * outArray,
+                                         const uint32_t inMaxCount,
+                                         uint16_t * outTimeStamps) {
+  const uint32_t savedMask = enterConsumerCriticalSection () ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  uint32_t n = 0 ;
+  if (mPackedBuffer != nullptr) {
+    while ((n < inMaxCount) && (readIndex != writeIndex)) {
+      readIndex = packedRemoveAt (readIndex, & outArray [n], (outTimeStamps != nullptr) ? & outTimeStamps [n] : nullptr) ;
+      n += 1 ;
+    }
+  }else{
+    const uint32_t available = countFor (readIndex, writeIndex) ;
+    n = (inMaxCount < available) ? inMaxCount : available ;
+    for (uint32_t i=0 ; i<n ; i++) {
+      outArray [i] = mBuffer [messageSlotFor (readIndex)] ;
+      if (outTimeStamps != nullptr) {
+        outTimeStamps [i] = (mTimeStamps != nullptr) ? mTimeStamps [messageSlotFor (readIndex)] : 0 ;
+      }
+      readIndex = nextIndex (readIndex) ;
+    }
+  }
+  mReadIndex.store (readIndex, std::memory_order_release) ;
+  leaveConsumerCriticalSection (savedMask) ;
+  return n ;
+}
+
+//------------------------------------------------------------------------------
+// Peek
+//------------------------------------------------------------------------------
+
+const CANFDMessage * ACANFD_STM32_FIFO::peek (uint16_t * outTimeStampPtr) const {
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  const CANFDMessage * messagePtr = nullptr ;
+  if ((readIndex != writeIndex) && (mPackedBuffer != nullptr)) {
+    packedDecode (readIndex, mPackedPeekMessage, outTimeStampPtr) ;
+    messagePtr = mPackedPeekMessage ;
+  }else if (readIndex != writeIndex) {
+    messagePtr = & mBuffer [messageSlotFor (readIndex)] ;
+    if (outTimeStampPtr != nullptr) {
+      *outTimeStampPtr = (mTimeStamps != nullptr) ? mTimeStamps [messageSlotFor (readIndex)] : 0 ;
+    }
+  }
+  return messagePtr ;
+}
+
+//------------------------------------------------------------------------------
+// Release
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_FIFO::release (void) {
+  const uint32_t savedMask = enterConsumerCriticalSection () ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  const bool ok = readIndex != writeIndex ;
+  if (mPackedBuffer != nullptr) {
+    if (ok) {
+      mReadIndex.store (packedRemoveAt (readIndex, nullptr, nullptr), std::memory_order_release) ;
+    }
+  }else if (ok) {
+    mReadIndex.store (nextIndex (readIndex), std::memory_order_release) ;
+  }
+  leaveConsumerCriticalSection (savedMask) ;
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Packed mode: decode the message at inIndex (if outMessagePtr is not nullptr),
+// and its time stamp (if outTimeStampPtr is not nullptr)
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+uint16_t ACANFD_STM32_FIFO::packedDecode (const uint16_t inIndex,
+                                          CANFDMessage * outMessagePtr,
+                                          uint16_t * outTimeStampPtr) const {
+  const uint32_t * p = & mPackedBuffer [packedMessageIndex (inIndex)] ;
+  const CANFDMessage::Type type = CANFDMessage::Type (p [0] >> 30) ;
+  const uint8_t len = uint8_t (p [1]) ;
+  const uint16_t wordCount = packedWordCountFor (type, len) ;
+  if (outMessagePtr != nullptr) {
+    outMessagePtr->id = p [0] & 0x1FFFFFFFU ;
+    outMessagePtr->ext = ((p [0] >> 29) & 1) != 0 ;
+    outMessagePtr->type = type ;
+    outMessagePtr->len = len ;
+    outMessagePtr->idx = uint8_t (p [1] >> 8) ;
+    for (uint16_t i=2 ; i<wordCount ; i++) {
+      outMessagePtr->data32 [i - 2] = p [i] ;
+    }
+  }
+  if (outTimeStampPtr != nullptr) {
+    *outTimeStampPtr = uint16_t (p [1] >> 16) ;
+  }
+  const uint16_t nextIndex = uint16_t (p - mPackedBuffer) + wordCount ;
+  return (nextIndex == mPackedWordSize) ? 0 : nextIndex ;
+}
+
+//------------------------------------------------------------------------------
+// Packed mode: remove (or skip) the message at inIndex
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+uint16_t ACANFD_STM32_FIFO::packedRemoveAt (const uint16_t inIndex,
+                                            CANFDMessage * outMessagePtr,
+                                            uint16_t * outTimeStampPtr) {
+  const uint16_t nextIndex = packedDecode (inIndex, outMessagePtr, outTimeStampPtr) ;
+  mRemovedCount.store (mRemovedCount.load (std::memory_order_relaxed) + 1, std::memory_order_release) ;
+  return nextIndex ;
+}
+
+//------------------------------------------------------------------------------
+// Packed mode: index where a message of inWordCount words can be written
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+bool ACANFD_STM32_FIFO::packedFreeIndex (const uint16_t inReadIndex,
+                                         const uint16_t inWriteIndex,
+                                         const uint16_t inWordCount,
+                                         uint16_t & outIndex) const {
+  bool ok ;
+  if (inWriteIndex >= inReadIndex) { // Free words: [inWriteIndex, end of ring[ and [0, inReadIndex - 1[
+    const uint32_t end = uint32_t (inWriteIndex) + inWordCount ;
+    ok = (end < mPackedWordSize) || ((end == mPackedWordSize) && (inReadIndex > 0)) ;
+    if (ok) {
+      outIndex = inWriteIndex ;
+    }else{ // Skip end of ring
+      outIndex = 0 ;
+      ok = inWordCount < inReadIndex ;
+    }
+  }else{ // Free words: [inWriteIndex, inReadIndex - 1[
+    outIndex = inWriteIndex ;
+    ok = (uint32_t (inWriteIndex) + inWordCount) < inReadIndex ;
+  }
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Packed mode: commit
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+bool ACANFD_STM32_FIFO::packedCommit (const uint16_t inTimeStamp) {
+  const CANFDMessage & message = *mPackedReserveMessage ;
+  const uint16_t wordCount = packedWordCountFor (message.type, message.len) ;
+  uint16_t readIndex = mReadIndex.load (std::memory_order_acquire) ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_relaxed) ;
+  uint16_t index = 0 ;
+  const bool accepted = (message.type == CANFDMessage::CAN_REMOTE) || (message.len <= mPackedMaxPayload) ;
+  bool ok = accepted && packedFreeIndex (readIndex, writeIndex, wordCount, index) ;
+  if (!accepted) { // Payload larger than maximum payload
+    mPayloadDroppedCount.store (mPayloadDroppedCount.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed) ;
+  }else if (!ok && (mSize > 0)) {
+    mPeakCount = mSize + 1 ;
+    if (!mOverwriteOldest) { // Drop new message
+      mDroppedCount.store (mDroppedCount.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed) ;
+    }else{ // Drop oldest messages until new one fits
+      while (!ok && (readIndex != writeIndex)) {
+        readIndex = packedRemoveAt (readIndex, nullptr, nullptr) ;
+        mDroppedCount.store (mDroppedCount.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed) ;
+        ok = packedFreeIndex (readIndex, writeIndex, wordCount, index) ;
+      }
+      mReadIndex.store (readIndex, std::memory_order_release) ;
+      if (!ok) { // Message larger than ring
+        mDroppedCount.store (mDroppedCount.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed) ;
+      }
+    }
+  }
   if (ok) {
-    outMessage = mBuffer [mReadIndex] ;
-    mCount -= 1 ;
-    mReadIndex += 1 ;
-    if (mReadIndex == mSize) {
-      mReadIndex = 0 ;
+    if ((index != writeIndex) && ((mPackedWordSize - writeIndex) >= 2)) {
+      mPackedBuffer [writeIndex + 1] = PACKED_SKIP_MARK ;
+    }
+    uint32_t * p = & mPackedBuffer [index] ;
+    p [0] = (message.id & 0x1FFFFFFFU) | (uint32_t (message.ext) << 29) | (uint32_t (message.type) << 30) ;
+    p [1] = uint32_t (message.len) | (uint32_t (message.idx) << 8) | (uint32_t (inTimeStamp) << 16) ;
+    for (uint16_t i=2 ; i<wordCount ; i++) {
+      p [i] = message.data32 [i - 2] ;
+    }
+    const uint16_t nextIndex = index + wordCount ;
+    const uint32_t appendedCount = mAppendedCount.load (std::memory_order_relaxed) + 1 ;
+    mAppendedCount.store (appendedCount, std::memory_order_release) ;
+    mWriteIndex.store ((nextIndex == mPackedWordSize) ? 0 : nextIndex, std::memory_order_release) ;
+    const uint32_t n = appendedCount - mRemovedCount.load (std::memory_order_relaxed) ;
+    if (mPeakCount < n) {
+      mPeakCount = uint16_t (n) ;
     }
   }
   return ok ;
@@ -79,11 +512,25 @@ bool ACANFD_STM32_FIFO::remove (CANFDMessage & outMessage) {
 //------------------------------------------------------------------------------
 
 void ACANFD_STM32_FIFO::free (void) {
-  delete [] mBuffer ; mBuffer = nullptr ;
-  mSize = 0 ;
-  mReadIndex = 0 ;
-  mCount = 0 ;
-  mPeakCount = 0 ;
+  if (mOwnsBuffer) {
+    delete [] mBuffer ;
+    delete [] mTxOptions ;
+    delete [] mTimeStamps ;
+    delete [] mSlotOrder ;
+    delete [] mPackedBuffer ;
+  }
+  mBuffer = nullptr ;
+  mTxOptions = nullptr ;
+  mTimeStamps = nullptr ;
+  mSlotOrder = nullptr ;
+  mPackedBuffer = nullptr ;
+  mPackedReserveMessage = nullptr ;
+  mPackedPeekMessage = nullptr ;
+  mPackedWordSize = 0 ;
+  mAppendedCount.store (0) ;
+  mRemovedCount.store (0) ;
+  mPayloadDroppedCount.store (0) ;
+  resetRing (0) ;
 }
 
 //------------------------------------------------------------------------------
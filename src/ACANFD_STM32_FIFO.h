@@ -5,10 +5,71 @@
 //------------------------------------------------------------------------------
 
 #include <ACANFD_STM32_CANFDMessage.h>
+#include <ACANFD_STM32_CriticalSection.h>
+#include <ACANFD_STM32_FastMemory.h>
+#include <ACANFD_STM32_RingIndexes.h>
+
+#include <atomic>
+
+//------------------------------------------------------------------------------
+// Transmit completion callback: hardware Tx buffer index, and message marker
+
+typedef void (*ACANFDTxCompletionCallBack) (const uint32_t inTxBufferIndex, const uint8_t inMarker) ;
+
+//------------------------------------------------------------------------------
+//    Transmit options of a message: they are stored by the driver along with
+//    the message (driver transmit FIFO slot, then hardware Tx buffer), as
+//    CANFDMessage is shared with other CANFD drivers
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_TxOptions {
+  public: ACANFDTxCompletionCallBack mCallBack = nullptr ; // Transmit completion callback (nullptr: none)
+  public: uint32_t mDeadline = 0 ; // Transmit deadline, micros () value (0: no deadline)
+  public: uint8_t mMarker = 0 ; // Message marker, copied in the Tx event of the sent frame
+
+  public: inline bool isExpired (const uint32_t inNowMicros) const {
+    return (mDeadline != 0) && (int32_t (inNowMicros - mDeadline) >= 0) ;
+  }
+} ;
 
+//------------------------------------------------------------------------------
+// Single producer / single consumer ring (see ACANFD_STM32_RingIndexes):
+//   - the producer (append, reserve, commit) only writes mWriteIndex;
+//   - the consumer (remove, removeArray, peek, release) only writes mReadIndex.
+// So a producer running from an interrupt and a consumer running from the
+// application do not need any critical section. The size is limited to
+// MAX_SIZE (32767).
+// When full, the producer drops the new message (default), or, in overwrite
+// oldest mode, drops the oldest one: it then also writes mReadIndex, so consumer
+// methods run within a critical section that masks the producer interrupt.
+// Dropped messages are counted by the producer.
+// Optionally, every slot has a receive time stamp (commit, remove, removeArray,
+// peek), or transmit options (append, insertByPriority, remove). A FIFO with
+// transmit options also has a slot order array, that gives the message slot of
+// every ring index: insertByPriority and removeExpired reorder messages by
+// moving 16-bit slot indexes, messages and transmit options are not moved.
+// Storage is either allocated on the heap (initWithSize), or provided by the
+// caller (initWithBuffer, for example a static array): it is then never freed.
+// In packed mode (initPackedWithSize, initPackedWithBuffer), storage is a word
+// ring where every message takes a two word header and only its payload (len
+// bytes, rounded up to a multiple of 4): 16 bytes for an 8-byte frame, instead
+// of sizeof (CANFDMessage) = 72 bytes. A message that does not fit before the
+// end of the ring is written at its beginning, the end is skipped. mReadIndex
+// and mWriteIndex are then word indexes (one word is kept free, so that a full
+// ring is distinguished from an empty one), and messages are counted by
+// mAppendedCount and mRemovedCount. reserve returns a staging message, commit
+// packs it: overflow is detected by commit. The reserve and peek staging
+// messages are taken from the packed storage, so a non packed FIFO does not
+// pay for them. Packed mode is intended for receive
+// FIFOs: insertByPriority, removeExpired and transmit options are not available,
+// the time stamp is always stored (in the message header). A packed FIFO has a
+// maximum payload (64 by default): commit drops a data frame with a longer
+// payload, counted by payloadDroppedCount (not by droppedCount), so a classic
+// CAN FIFO (maximum payload 8) is sized with packedStorageWordCount for a
+// given message count, at 16 bytes per message.
 //------------------------------------------------------------------------------
 
-class ACANFD_STM32_FIFO {
+class ACANFD_STM32_FIFO : public ACANFD_STM32_RingIndexes {
 
   //············································································
   // Default constructor
@@ -27,40 +88,235 @@ class ACANFD_STM32_FIFO {
   //············································································
 
   private: CANFDMessage * mBuffer ;
-  private: uint16_t mSize ;
-  private: uint16_t mReadIndex ;
-  private: uint16_t mCount ;
-  private: uint16_t mPeakCount ; // > mSize if overflow did occur
+  private: ACANFD_STM32_TxOptions * mTxOptions ; // nullptr if not used
+  private: uint16_t * mTimeStamps ; // nullptr if not used
+  private: uint16_t * mSlotOrder ; // Ring index -> message slot (nullptr if not used)
+  private: bool mOverwriteOldest ;
+  private: bool mOwnsBuffer ; // false if storage is provided by initWithBuffer
+  private: uint32_t mConsumerBasePriority ; // For consumer critical sections
+  private: uint32_t * mPackedBuffer ; // nullptr if not in packed mode
+  private: CANFDMessage * mPackedReserveMessage ; // Packed mode: staging message of reserve / commit
+  private: CANFDMessage * mPackedPeekMessage ; // Packed mode: unpacked copy returned by peek
+  private: uint16_t mPackedWordSize ;
+  private: uint8_t mPackedMaxPayload ; // Packed mode: longer data frames are dropped
+  private: std::atomic <uint32_t> mPayloadDroppedCount ; // Packed mode: data frames longer than mPackedMaxPayload
+  private: std::atomic <uint32_t> mAppendedCount ; // Packed mode, written by producer only
+  private: std::atomic <uint32_t> mRemovedCount ; // Packed mode, written by consumer (and producer in overwrite oldest mode)
+
+  //············································································
+  // Private methods
+  //············································································
+
+  private: inline uint16_t messageSlotFor (const uint16_t inIndex) const {
+    const uint16_t slot = slotFor (inIndex) ;
+    return (mSlotOrder != nullptr) ? mSlotOrder [slot] : slot ;
+  }
+
+  //--- Arbitration priority of a message (lower value wins arbitration): base
+  //    identifier, then standard frame before extended frame, then extension
+  private: static inline uint32_t priorityKey (const CANFDMessage & inMessage) {
+    return inMessage.ext
+      ? (((inMessage.id >> 18) & 0x7FFU) << 19) | (1U << 18) | (inMessage.id & 0x3FFFFU)
+      : ((inMessage.id & 0x7FFU) << 19)
+    ;
+  }
+
+  //--- Packed mode: word count of a message, index of the message at inIndex
+  //    (0 if end of ring is skipped), decode / remove the message at inIndex
+  //    (outMessagePtr and outTimeStampPtr may be nullptr), returning the next
+  //    read index
+  private: static inline uint16_t packedWordCountFor (const CANFDMessage::Type inType, const uint8_t inLength) {
+    return 2 + ((inType == CANFDMessage::CAN_REMOTE) ? 0 : ((inLength + 3) / 4)) ;
+  }
+
+  private: inline uint16_t packedMessageIndex (const uint16_t inIndex) const {
+    return ((mPackedWordSize - inIndex) < 2) || (mPackedBuffer [inIndex + 1] == PACKED_SKIP_MARK) ? 0 : inIndex ;
+  }
+
+  private: uint16_t packedDecode (const uint16_t inIndex,
+                                  CANFDMessage * outMessagePtr,
+                                  uint16_t * outTimeStampPtr) const ;
+
+  private: uint16_t packedRemoveAt (const uint16_t inIndex,
+                                    CANFDMessage * outMessagePtr,
+                                    uint16_t * outTimeStampPtr) ;
+
+  private: bool packedFreeIndex (const uint16_t inReadIndex,
+                                 const uint16_t inWriteIndex,
+                                 const uint16_t inWordCount,
+                                 uint16_t & outIndex) const ;
+
+  private: bool packedCommit (const uint16_t inTimeStamp) ;
+
+  //--- Second header word of a skipped ring end (never a valid one, as len <= 64)
+  private: static const uint32_t PACKED_SKIP_MARK = 0xFFFFFFFFU ;
+
+  //--- Packed mode: words taken by the two staging messages at the end of the
+  //    storage (one more word for their alignment)
+  private: static const uint32_t PACKED_STAGING_WORD_COUNT = (2 * sizeof (CANFDMessage) + alignof (CANFDMessage) - 4) / 4 ;
+
+  private: inline uint32_t enterConsumerCriticalSection (void) const {
+    return mOverwriteOldest ? ACANFD_STM32_CriticalSection::enter (mConsumerBasePriority) : 0 ;
+  }
+
+  private: inline void leaveConsumerCriticalSection (const uint32_t inSavedMask) const {
+    if (mOverwriteOldest) {
+      ACANFD_STM32_CriticalSection::leave (mConsumerBasePriority, inSavedMask) ;
+    }
+  }
 
   //············································································
   // Accessors
   //············································································
 
-  public: inline uint16_t size (void) const { return mSize ; }
-  public: inline uint16_t count (void) const { return mCount ; }
-  public: inline bool isEmpty (void) const { return (mCount == 0) && (mSize > 0) ; }
-  public: inline bool isFull (void) const { return mCount == mSize ; }
-  public: inline bool didOverflow (void) const { return mPeakCount > mSize ; }
-  public: inline uint16_t peakCount (void) const { return mPeakCount ; }
+  public: inline uint16_t count (void) const {
+    uint32_t n ;
+    if (mPackedBuffer != nullptr) { // Removed count first: it never exceeds appended count
+      const uint32_t removedCount = mRemovedCount.load (std::memory_order_acquire) ;
+      n = mAppendedCount.load (std::memory_order_acquire) - removedCount ;
+    }else{
+      n = ringCount () ;
+    }
+    return (n < mSize) ? uint16_t (n) : mSize ; // Indexes may be read across an overwrite
+  }
+  public: inline bool isEmpty (void) const { return (count () == 0) && (mSize > 0) ; }
+  public: inline bool isFull (void) const { return count () == mSize ; }
+  public: inline bool overwriteOldest (void) const { return mOverwriteOldest ; }
+  public: inline bool isPacked (void) const { return mPackedBuffer != nullptr ; }
+  public: inline uint32_t payloadDroppedCount (void) const { return mPayloadDroppedCount.load (std::memory_order_relaxed) ; }
+
+  //············································································
+  // initWithSize, initWithBuffer: a size greater than MAX_SIZE is reduced to
+  // MAX_SIZE
+  //············································································
+
+  public: void initWithSize (const uint16_t inSize,
+                             const bool inWithTxOptions = false,
+                             const bool inWithTimeStamps = false) ;
+
+  //············································································
+  // initWithBuffer: caller provided storage (inTxOptions, inSlotOrder and
+  // inTimeStamps, if not nullptr, have inSize elements), that should outlive
+  // the FIFO. Transmit options are used only with a slot order array.
+  //············································································
+
+  public: void initWithBuffer (CANFDMessage * inBuffer,
+                               const uint16_t inSize,
+                               ACANFD_STM32_TxOptions * inTxOptions = nullptr,
+                               uint16_t * inSlotOrder = nullptr,
+                               uint16_t * inTimeStamps = nullptr) ;
+
+  //············································································
+  // Packed mode: inByteSize is rounded down to a multiple of 4. The two
+  // staging messages (reserve, peek) take the end of the storage (148 bytes),
+  // the ring takes the remaining words (at most 65535); size () returns the
+  // largest message count ((ring words - 1) / 2, if all messages have no
+  // payload). A storage too small for staging messages gives a FIFO that drops
+  // every message. initPackedWithBuffer uses caller provided storage
+  // (inWordCount words), that should outlive the FIFO. inMaxPayload (limited
+  // to 64) is the largest accepted payload. packedStorageWordCount returns the
+  // word count that guarantees room for inMessageCount messages of
+  // inMaxPayload bytes (one more message covers the skipped end of ring and
+  // the free word), staging messages included
+  //············································································
+
+  public: void initPackedWithSize (const uint32_t inByteSize,
+                                   const uint8_t inMaxPayload = 64) ;
+
+  public: void initPackedWithBuffer (uint32_t * inBuffer,
+                                     const uint32_t inWordCount,
+                                     const uint8_t inMaxPayload = 64) ;
+
+  public: static constexpr uint32_t packedStorageWordCount (const uint16_t inMessageCount,
+                                                            const uint8_t inMaxPayload) {
+    return PACKED_STAGING_WORD_COUNT
+      + (uint32_t (inMessageCount) + 1) * (2 + ((uint32_t ((inMaxPayload < 64) ? inMaxPayload : 64) + 3) / 4))
+    ;
+  }
+
+  //············································································
+  // Overflow policy (call when producer is not running): drop newest (false),
+  // or overwrite oldest (true). inConsumerBasePriority is the base priority of
+  // the consumer critical sections (see ACANFD_STM32_CriticalSection)
+  //············································································
+
+  public: void setOverwriteOldest (const bool inOverwriteOldest,
+                                   const uint32_t inConsumerBasePriority) ;
+
+  //············································································
+  // append (producer)
+  //············································································
+
+  public: bool append (const CANFDMessage & inMessage,
+                       const ACANFD_STM32_TxOptions & inTxOptions = ACANFD_STM32_TxOptions ()) ;
 
   //············································································
-  // initWithSize
+  // Insert by arbitration priority (producer): the message is inserted before
+  // messages with a lower priority (messages with the same priority remain in
+  // order), so remove returns the highest priority message (without transmit
+  // options, it is appended). Insertion moves slot indexes that the consumer
+  // may read: it should be called while the consumer is masked (critical section)
   //············································································
 
-  public: void initWithSize (const uint16_t inSize) ;
+  public: bool insertByPriority (const CANFDMessage & inMessage,
+                                 const ACANFD_STM32_TxOptions & inTxOptions = ACANFD_STM32_TxOptions ()) ;
 
   //············································································
-  // append
+  // Remove messages whose deadline is expired (transmit options), keeping order
+  // of others; returns the number of removed messages. It changes the write
+  // index and slot indexes: it should be called while producer and consumer
+  // are masked (critical section)
   //············································································
 
-  public: bool append (const CANFDMessage & inMessage) ;
+  public: uint32_t removeExpired (const uint32_t inNowMicros) ;
 
   //············································································
-  // Remove
+  // In place append (producer): reserve returns the next free slot (if FIFO is
+  // full, overflow is recorded, and reserve returns nullptr, or, in overwrite
+  // oldest mode, the slot of the dropped oldest message), commit enters it into
+  // the FIFO, with its receive time stamp. In packed mode, reserve returns a
+  // staging message, and commit returns false if the message is dropped
+  //············································································
+
+  public: CANFDMessage * reserve (void) ;
+
+  public: bool commit (const uint16_t inTimeStamp = 0) ;
+
+  //············································································
+  // Remove (consumer); transmit options and time stamp are default ones (0) if
+  // they are not stored
   //············································································
 
   public: bool remove (CANFDMessage & outMessage) ;
 
+  public: bool remove (CANFDMessage & outMessage,
+                       ACANFD_STM32_TxOptions & outTxOptions) ;
+
+  public: bool remove (CANFDMessage & outMessage,
+                       uint16_t & outTimeStamp) ;
+
+  //············································································
+  // Remove at most inMaxCount messages, returns the number of removed messages
+  // (consumer); outTimeStamps (if not nullptr) receives their time stamps
+  //············································································
+
+  public: uint32_t removeArray (CANFDMessage * outArray,
+                                const uint32_t inMaxCount,
+                                uint16_t * outTimeStamps = nullptr) ;
+
+  //············································································
+  // Zero copy access (consumer): peek returns the oldest message (nullptr if
+  // empty), it remains valid until release is called, release removes it
+  // (in packed mode, it is an unpacked copy). If outTimeStampPtr is not nullptr,
+  // it receives its time stamp.
+  // In overwrite oldest mode, the producer may replace the peeked message by a
+  // newer one: use remove or removeArray instead
+  //············································································
+
+  public: const CANFDMessage * peek (uint16_t * outTimeStampPtr = nullptr) const ;
+
+  public: bool release (void) ;
+
   //············································································
   // Free
   //············································································
@@ -71,7 +327,7 @@ class ACANFD_STM32_FIFO {
   // Reset Peak Count
   //············································································
 
-  public: inline void resetPeakCount (void) { mPeakCount = mCount ; }
+  public: inline void resetPeakCount (void) { mPeakCount = count () ; }
 
   //············································································
   // No copy
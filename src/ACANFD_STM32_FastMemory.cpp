@@ -0,0 +1,38 @@
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_FastMemory.h>
+
+//------------------------------------------------------------------------------
+
+#ifdef ACANFD_STM32_HAS_FAST_MEMORIES
+
+//--- Defined by linker script fragment
+  extern "C" uint32_t _siacanfd_fast_text ; // Load address (flash)
+  extern "C" uint32_t _sacanfd_fast_text ; // Start address (fast memory)
+  extern "C" uint32_t _eacanfd_fast_text ; // End address (fast memory)
+
+  static bool gFastCodeCopied = false ;
+
+#endif
+
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_FastMemory::copyCode (void) {
+  #ifdef ACANFD_STM32_HAS_FAST_MEMORIES
+    if (!gFastCodeCopied) {
+      gFastCodeCopied = true ;
+      const uint32_t * source = & _siacanfd_fast_text ;
+      uint32_t * destination = & _sacanfd_fast_text ;
+      while (destination < & _eacanfd_fast_text) {
+        *destination = *source ;
+        destination += 1 ;
+        source += 1 ;
+      }
+    //--- Code is written by data accesses: complete them before fetching it
+      __DSB () ;
+      __ISB () ;
+    }
+  #endif
+}
+
+//------------------------------------------------------------------------------
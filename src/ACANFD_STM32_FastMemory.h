@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <Arduino.h>
+
+//------------------------------------------------------------------------------
+//  Placement in fast memories (opt-in)
+//------------------------------------------------------------------------------
+// When ACANFD_STM32_USE_FAST_MEMORIES is defined (for example by a build_opt.h
+// file in the sketch folder, containing -DACANFD_STM32_USE_FAST_MEMORIES):
+//   - the interrupt path (isr0, isr1, message RAM read / write, driver FIFO
+//     reserve / commit / remove, Tx event FIFO reserve / commit, latest value
+//     cache write, remote frame responder) is placed in the .acanfd_fast_text
+//     section, that runs from CCM SRAM (G431, G474) or ITCM (H723, H743). The
+//     only flash call left is micros (), when a driver transmit FIFO message
+//     has a deadline;
+//   - ACANFD_STM32_FAST_DATA places a variable in the .acanfd_fast_data section,
+//     in CCM SRAM or DTCM: use it for driver FIFO static storage (see
+//     ACANFD_STM32_Settings::setDriverReceiveFIFO0Storage). This section is
+//     neither loaded from flash nor zeroed at startup (the compiler may turn a
+//     constructor into static data, that is lost): its initial content is
+//     undefined. The driver writes its FIFO storage before reading it; do not
+//     use ACANFD_STM32_FAST_DATA for variables that need an initial value.
+// Both sections should be defined by the board linker script: fragments are in
+// extras/linker-fragments. The code is copied from flash by the first beginFD
+// call. Calls between flash and fast memory code are out of BL range, the
+// linker inserts long branch veneers.
+// G0B1 has no fast memory: macros are empty.
+//------------------------------------------------------------------------------
+
+#ifdef ACANFD_STM32_USE_FAST_MEMORIES
+  #if defined (ARDUINO_NUCLEO_G431KB) || defined (ARDUINO_NUCLEO_G474RE) || defined (ARDUINO_WEACT_G474CE) \
+   || defined (ARDUINO_NUCLEO_H743ZI2) || defined (ARDUINO_NUCLEO_H723ZG)
+    #define ACANFD_STM32_HAS_FAST_MEMORIES
+    #define ACANFD_STM32_FAST_CODE __attribute__ ((section (".acanfd_fast_text"), noinline))
+    #define ACANFD_STM32_FAST_DATA __attribute__ ((section (".acanfd_fast_data")))
+  #endif
+#endif
+
+#ifndef ACANFD_STM32_HAS_FAST_MEMORIES
+  #define ACANFD_STM32_FAST_CODE
+  #define ACANFD_STM32_FAST_DATA
+#endif
+
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_FastMemory {
+
+//--- Copy .acanfd_fast_text from flash (done once, does nothing if fast
+//    memories are not used)
+  public: static void copyCode (void) ;
+
+//--- Fast memories are used ?
+  public: static inline bool enabled (void) {
+    #ifdef ACANFD_STM32_HAS_FAST_MEMORIES
+      return true ;
+    #else
+      return false ;
+    #endif
+  }
+} ;
+
+//------------------------------------------------------------------------------
@@ -1,6 +1,6 @@
 //------------------------------------------------------------------------------
 
-#include <ACANFD_STM32_Filters.h>
+#include <ACANFD_STM32_Settings.h>
 
 //------------------------------------------------------------------------------
 //    Standard filters
@@ -67,6 +67,23 @@ bool ACANFD_STM32_StandardFilters::addClassic (const uint16_t inIdentifier,
   return ok ;
 }
 
+//------------------------------------------------------------------------------
+
+#if HAS_PROGRAMMABLE_FDCAN_RAM_SECTIONS == true
+  bool ACANFD_STM32_StandardFilters::addRxBuffer (const uint16_t inIdentifier,
+                                                  const uint8_t inRxBufferIndex) {
+    const bool ok = (inIdentifier <= 0x7FF) && (inRxBufferIndex < 64) ;
+    if (ok) {
+      uint32_t filter = inRxBufferIndex ; // SFID2 [10:9] = 0: store into Rx buffer
+      filter |= uint32_t (inIdentifier) << 16 ;
+      filter |= (7U << 27) ; // Filter action: store into Rx buffer
+      mFilterArray.append (filter) ;
+      mCallBackArray.append (nullptr) ;
+    }
+    return ok ;
+  }
+#endif
+
 //------------------------------------------------------------------------------
 //    Extended filters
 //------------------------------------------------------------------------------
@@ -142,3 +159,21 @@ bool ACANFD_STM32_ExtendedFilters::addClassic (const uint32_t inIdentifier,
 }
 
 //------------------------------------------------------------------------------
+
+#if HAS_PROGRAMMABLE_FDCAN_RAM_SECTIONS == true
+  bool ACANFD_STM32_ExtendedFilters::addRxBuffer (const uint32_t inIdentifier,
+                                                  const uint8_t inRxBufferIndex) {
+    const bool ok = (inIdentifier <= MAX_EXTENDED_IDENTIFIER) && (inRxBufferIndex < 64) ;
+    if (ok) {
+      uint32_t filter = inIdentifier ;
+      filter |= (7U << 29) ; // Filter action: store into Rx buffer
+      mFilterArray.append (filter) ;
+      filter = inRxBufferIndex ; // EFID2 [10:9] = 0: store into Rx buffer
+      mFilterArray.append (filter) ;
+      mCallBackArray.append (nullptr) ;
+    }
+    return ok ;
+  }
+#endif
+
+//------------------------------------------------------------------------------
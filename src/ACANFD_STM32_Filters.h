@@ -9,6 +9,12 @@
 
 //------------------------------------------------------------------------------
 
+#ifndef HAS_PROGRAMMABLE_FDCAN_RAM_SECTIONS
+  #error "HAS_PROGRAMMABLE_FDCAN_RAM_SECTIONS is not defined"
+#endif
+
+//------------------------------------------------------------------------------
+
 enum class ACANFD_STM32_FilterAction {
   FIFO0 = 0,
   FIFO1 = 1,
@@ -43,6 +49,14 @@ class ACANFD_STM32_StandardFilters {
                            const ACANFD_STM32_FilterAction inAction,
                            const ACANFDCallBackRoutine inCallBack = nullptr) ;
 
+//--- Store matching frames into a dedicated Rx buffer (programmable RAM section
+//    modules only); see ACANFD_STM32::readRxBuffer. inRxBufferIndex should be
+//    lower than ACANFD_STM32_Settings::mHardwareRxBufferCount (checked by beginFD)
+  #if HAS_PROGRAMMABLE_FDCAN_RAM_SECTIONS == true
+    public: bool addRxBuffer (const uint16_t inIdentifier,
+                              const uint8_t inRxBufferIndex) ;
+  #endif
+
 //--- Access
   public: uint32_t count () const {
     return mFilterArray.count () ;
@@ -93,6 +107,14 @@ class ACANFD_STM32_ExtendedFilters {
                            const ACANFD_STM32_FilterAction inAction,
                            const ACANFDCallBackRoutine inCallBack = nullptr) ;
 
+//--- Store matching frames into a dedicated Rx buffer (programmable RAM section
+//    modules only); see ACANFD_STM32::readRxBuffer. inRxBufferIndex should be
+//    lower than ACANFD_STM32_Settings::mHardwareRxBufferCount (checked by beginFD)
+  #if HAS_PROGRAMMABLE_FDCAN_RAM_SECTIONS == true
+    public: bool addRxBuffer (const uint32_t inExtendedIdentifier,
+                              const uint8_t inRxBufferIndex) ;
+  #endif
+
 //--- Access
   public: uint32_t count () const { return mCallBackArray.count () ; }
   public: uint32_t firstWordAtIndex (const uint32_t inIndex) const { return mFilterArray [inIndex * 2] ; }
@@ -0,0 +1,180 @@
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_LatestValueCache.h>
+
+//------------------------------------------------------------------------------
+// Default constructor
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_LatestValueCache::ACANFD_STM32_LatestValueCache (void) :
+mMessages (nullptr),
+mSequences (nullptr),
+mKeys (nullptr),
+mHashTable (nullptr),
+mCapacity (0),
+mCount (0),
+mHashTableMask (0) {
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_LatestValueCache:: ~ ACANFD_STM32_LatestValueCache (void) {
+  free () ;
+}
+
+//------------------------------------------------------------------------------
+// initWithCapacity
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_LatestValueCache::initWithCapacity (const uint16_t inCapacity) {
+  free () ;
+  const uint16_t capacity = (inCapacity < 0x4000) ? inCapacity : 0x4000 ;
+  uint32_t hashTableSize = 1 ;
+  while (hashTableSize < (2U * capacity)) {
+    hashTableSize <<= 1 ;
+  }
+  mMessages = new CANFDMessage [capacity] ;
+  mSequences = new std::atomic <uint32_t> [capacity] ;
+  mKeys = new uint32_t [capacity] ;
+  mHashTable = new uint16_t [hashTableSize] ;
+  for (uint32_t i=0 ; i<hashTableSize ; i++) {
+    mHashTable [i] = 0 ;
+  }
+  mCapacity = capacity ;
+  mHashTableMask = uint16_t (hashTableSize - 1) ;
+}
+
+//------------------------------------------------------------------------------
+// Add identifiers
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_LatestValueCache::addStandardIdentifier (const uint16_t inIdentifier) {
+  return (inIdentifier <= 0x7FF) && addKey (keyFor (false, inIdentifier)) ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_LatestValueCache::addExtendedIdentifier (const uint32_t inIdentifier) {
+  return (inIdentifier <= 0x1FFFFFFF) && addKey (keyFor (true, inIdentifier)) ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_LatestValueCache::addKey (const uint32_t inKey) {
+  bool ok = mCount < mCapacity ;
+  uint32_t slot = slotFor (inKey) ;
+  while (ok && (mHashTable [slot] != 0)) {
+    ok = mKeys [mHashTable [slot] - 1] != inKey ;
+    slot = (slot + 1) & mHashTableMask ;
+  }
+  if (ok) {
+    mHashTable [slot] = mCount + 1 ;
+    mKeys [mCount] = inKey ;
+    mSequences [mCount].store (0) ;
+    mCount += 1 ;
+  }
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Entry lookup
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+uint16_t ACANFD_STM32_LatestValueCache::entryIndexForKey (const uint32_t inKey) const {
+  uint16_t entryIndex = kNoEntry ;
+  if (mCount > 0) {
+    uint32_t slot = slotFor (inKey) ;
+    while ((entryIndex == kNoEntry) && (mHashTable [slot] != 0)) {
+      const uint16_t idx = mHashTable [slot] - 1 ;
+      if (mKeys [idx] == inKey) {
+        entryIndex = idx ;
+      }
+      slot = (slot + 1) & mHashTableMask ;
+    }
+  }
+  return entryIndex ;
+}
+
+//------------------------------------------------------------------------------
+// Update
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+CANFDMessage * ACANFD_STM32_LatestValueCache::beginWrite (const uint16_t inEntryIndex) {
+  const uint32_t sequence = mSequences [inEntryIndex].load (std::memory_order_relaxed) ;
+  mSequences [inEntryIndex].store (sequence + 1, std::memory_order_relaxed) ; // Odd: write in progress
+  std::atomic_thread_fence (std::memory_order_release) ;
+  return & mMessages [inEntryIndex] ;
+}
+
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32_LatestValueCache::endWrite (const uint16_t inEntryIndex) {
+  const uint32_t sequence = mSequences [inEntryIndex].load (std::memory_order_relaxed) ;
+  mSequences [inEntryIndex].store (sequence + 1, std::memory_order_release) ; // Even: write done
+}
+
+//------------------------------------------------------------------------------
+// Read
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_LatestValueCache::read (const bool inExtended,
+                                          const uint32_t inIdentifier,
+                                          CANFDMessage & outMessage,
+                                          uint32_t & ioSequence) const {
+  const uint16_t entryIndex = entryIndexForKey (keyFor (inExtended, inIdentifier)) ;
+  bool updated = false ;
+  if (entryIndex != kNoEntry) {
+    bool loop = true ;
+    while (loop) {
+      const uint32_t sequence = mSequences [entryIndex].load (std::memory_order_acquire) ;
+      if ((sequence & 1) != 0) { // Write in progress (only when read runs with a higher priority)
+        loop = false ;
+      }else if (sequence == ioSequence) { // No new value
+        loop = false ;
+      }else{
+        outMessage = mMessages [entryIndex] ;
+        std::atomic_thread_fence (std::memory_order_acquire) ;
+        loop = mSequences [entryIndex].load (std::memory_order_relaxed) != sequence ;
+        if (!loop) {
+          ioSequence = sequence ;
+          updated = true ;
+        }
+      }
+    }
+  }
+  return updated ;
+}
+
+//------------------------------------------------------------------------------
+// Sequence number
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32_LatestValueCache::sequence (const bool inExtended,
+                                                  const uint32_t inIdentifier) const {
+  const uint16_t entryIndex = entryIndexForKey (keyFor (inExtended, inIdentifier)) ;
+  return (entryIndex != kNoEntry)
+    ? (mSequences [entryIndex].load (std::memory_order_acquire) & ~ 1U)
+    : 0
+  ;
+}
+
+//------------------------------------------------------------------------------
+// Free
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_LatestValueCache::free (void) {
+  delete [] mMessages ; mMessages = nullptr ;
+  delete [] mSequences ; mSequences = nullptr ;
+  delete [] mKeys ; mKeys = nullptr ;
+  delete [] mHashTable ; mHashTable = nullptr ;
+  mCapacity = 0 ;
+  mCount = 0 ;
+  mHashTableMask = 0 ;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,143 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_CANFDMessage.h>
+#include <ACANFD_STM32_FastMemory.h>
+
+#include <atomic>
+
+//------------------------------------------------------------------------------
+// Latest value cache: stores the most recent received frame for every
+// identifier added with addStandardIdentifier / addExtendedIdentifier.
+// When a cache is given to beginFD (ACANFD_STM32_Settings::mLatestValueCache),
+// received frames whose identifier is in the cache overwrite the cache entry,
+// they are not appended to the driver receive FIFOs.
+// Identifiers should be added before beginFD is called. Lookup uses an open
+// addressing hash table, its size is a power of 2 at least twice the capacity.
+// Every entry has a sequence number, incremented twice on each update (odd while
+// the entry is written by the receive interrupt): read returns the entry only
+// if its sequence number differs from the one given by the caller, and retries
+// copying if the entry has been updated during the copy.
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_LatestValueCache {
+
+  //············································································
+  // Default constructor
+  //············································································
+
+  public: ACANFD_STM32_LatestValueCache (void) ;
+
+  //············································································
+  // Destructor
+  //············································································
+
+  public: ~ ACANFD_STM32_LatestValueCache (void) ;
+
+  //············································································
+  // Constants
+  //············································································
+
+  public: static const uint16_t kNoEntry = 0xFFFF ;
+
+  //············································································
+  // Private properties
+  //············································································
+
+  private: CANFDMessage * mMessages ;
+  private: std::atomic <uint32_t> * mSequences ;
+  private: uint32_t * mKeys ;
+  private: uint16_t * mHashTable ; // Entry index + 1, 0 if empty slot
+  private: uint16_t mCapacity ;
+  private: uint16_t mCount ;
+  private: uint16_t mHashTableMask ;
+
+  //············································································
+  // Private methods
+  //············································································
+
+  private: inline uint32_t slotFor (const uint32_t inKey) const {
+    return ((inKey * 2654435769U) >> 16) & mHashTableMask ;
+  }
+
+  private: bool addKey (const uint32_t inKey) ;
+
+  //············································································
+  // Key from identifier
+  //············································································
+
+  public: static inline uint32_t keyFor (const bool inExtended, const uint32_t inIdentifier) {
+    return inExtended ? ((1U << 31) | inIdentifier) : inIdentifier ;
+  }
+
+  //············································································
+  // Accessors
+  //············································································
+
+  public: inline uint16_t capacity (void) const { return mCapacity ; }
+  public: inline uint16_t count (void) const { return mCount ; }
+
+  //············································································
+  // initWithCapacity (removes all identifiers)
+  //············································································
+
+  public: void initWithCapacity (const uint16_t inCapacity) ;
+
+  //············································································
+  // Add identifiers (returns false if identifier is invalid, already in
+  // cache, or if cache is full)
+  //············································································
+
+  public: bool addStandardIdentifier (const uint16_t inIdentifier) ;
+
+  public: bool addExtendedIdentifier (const uint32_t inIdentifier) ;
+
+  //············································································
+  // Entry lookup, returns kNoEntry if key is not in cache
+  //············································································
+
+  public: uint16_t entryIndexForKey (const uint32_t inKey) const ;
+
+  //············································································
+  // Update (receive interrupt only): beginWrite returns the message to write
+  //············································································
+
+  public: CANFDMessage * beginWrite (const uint16_t inEntryIndex) ;
+
+  public: void endWrite (const uint16_t inEntryIndex) ;
+
+  //············································································
+  // Read (application): returns true if the entry has been updated since
+  // ioSequence (0: never received), outMessage and ioSequence are then updated
+  //············································································
+
+  public: bool read (const bool inExtended,
+                     const uint32_t inIdentifier,
+                     CANFDMessage & outMessage,
+                     uint32_t & ioSequence) const ;
+
+  //············································································
+  // Current sequence number (0 if identifier has never been received, or is
+  // not in cache)
+  //············································································
+
+  public: uint32_t sequence (const bool inExtended, const uint32_t inIdentifier) const ;
+
+  //············································································
+  // Free
+  //············································································
+
+  public: void free (void) ;
+
+  //············································································
+  // No copy
+  //············································································
+
+  private: ACANFD_STM32_LatestValueCache (const ACANFD_STM32_LatestValueCache &) = delete ;
+  private: ACANFD_STM32_LatestValueCache & operator = (const ACANFD_STM32_LatestValueCache &) = delete ;
+} ;
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,123 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <stdint.h>
+
+#include <atomic>
+
+//------------------------------------------------------------------------------
+// Indexes of a single producer / single consumer ring, shared by
+// ACANFD_STM32_FIFO and ACANFD_STM32_TxEventFIFO:
+//   - the producer only writes mWriteIndex (release), after the slot;
+//   - the consumer only writes mReadIndex (release), after reading the slot.
+// Indexes run from 0 to 2 * mSize - 1, so that a full ring can be
+// distinguished from an empty one: as they are 16-bit, the size is limited
+// to MAX_SIZE. Overflow (a full ring when the producer appends) sets the
+// peak count to mSize + 1, and increments the dropped count.
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_RingIndexes {
+
+  //············································································
+  // Default constructor
+  //············································································
+
+  protected: ACANFD_STM32_RingIndexes (void) :
+  mSize (0),
+  mReadIndex (0),
+  mWriteIndex (0),
+  mPeakCount (0),
+  mDroppedCount (0) {
+  }
+
+  //············································································
+  // Properties
+  //············································································
+
+  public: static const uint16_t MAX_SIZE = 32767 ;
+
+  protected: uint16_t mSize ;
+  protected: std::atomic <uint16_t> mReadIndex ; // Written by consumer only
+  protected: std::atomic <uint16_t> mWriteIndex ; // Written by producer only
+  protected: uint16_t mPeakCount ; // > mSize if overflow did occur
+  protected: std::atomic <uint32_t> mDroppedCount ; // Written by producer only
+
+  //············································································
+  // Index arithmetic
+  //············································································
+
+  protected: inline uint16_t countFor (const uint16_t inReadIndex, const uint16_t inWriteIndex) const {
+    return (inWriteIndex >= inReadIndex)
+      ? (inWriteIndex - inReadIndex)
+      : (inWriteIndex + 2 * mSize - inReadIndex)
+    ;
+  }
+
+  protected: inline uint16_t slotFor (const uint16_t inIndex) const {
+    return (inIndex < mSize) ? inIndex : (inIndex - mSize) ;
+  }
+
+  protected: inline uint16_t nextIndex (const uint16_t inIndex) const {
+    return (inIndex == (2 * mSize - 1)) ? 0 : (inIndex + 1) ;
+  }
+
+  protected: inline uint16_t previousIndex (const uint16_t inIndex) const {
+    return (inIndex == 0) ? (2 * mSize - 1) : (inIndex - 1) ;
+  }
+
+  protected: inline uint16_t ringCount (void) const {
+    return countFor (mReadIndex.load (std::memory_order_acquire), mWriteIndex.load (std::memory_order_acquire)) ;
+  }
+
+  //············································································
+  // Producer: record an overflow; publish the slot at inWriteIndex, and update
+  // peak count
+  //············································································
+
+  protected: inline void recordOverflow (void) {
+    mPeakCount = mSize + 1 ;
+    mDroppedCount.store (mDroppedCount.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed) ;
+  }
+
+  protected: inline void publishSlot (const uint16_t inWriteIndex) {
+    const uint16_t writeIndex = nextIndex (inWriteIndex) ;
+    mWriteIndex.store (writeIndex, std::memory_order_release) ;
+    const uint16_t n = countFor (mReadIndex.load (std::memory_order_relaxed), writeIndex) ;
+    if (mPeakCount < n) {
+      mPeakCount = n ;
+    }
+  }
+
+  //············································································
+  // Reset (producer and consumer are not running); inSize is limited to MAX_SIZE
+  //············································································
+
+  protected: inline void resetRing (const uint16_t inSize) {
+    mSize = (inSize < MAX_SIZE) ? inSize : MAX_SIZE ;
+    mReadIndex.store (0) ;
+    mWriteIndex.store (0) ;
+    mPeakCount = 0 ;
+    mDroppedCount.store (0) ;
+  }
+
+  //············································································
+  // Accessors
+  //············································································
+
+  public: inline uint16_t size (void) const { return mSize ; }
+  public: inline bool didOverflow (void) const { return mPeakCount > mSize ; }
+  public: inline uint16_t peakCount (void) const { return mPeakCount ; }
+  public: inline uint32_t droppedCount (void) const { return mDroppedCount.load (std::memory_order_relaxed) ; }
+
+  //············································································
+  // No copy
+  //············································································
+
+  private: ACANFD_STM32_RingIndexes (const ACANFD_STM32_RingIndexes &) = delete ;
+  private: ACANFD_STM32_RingIndexes & operator = (const ACANFD_STM32_RingIndexes &) = delete ;
+} ;
+
+//------------------------------------------------------------------------------
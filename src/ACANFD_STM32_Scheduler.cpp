@@ -0,0 +1,179 @@
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_Scheduler.h>
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_Scheduler::ACANFD_STM32_Scheduler (ACANFD_STM32 & inDriver,
+                                                const uint16_t inCapacity) :
+mDriver (inDriver),
+mEntries (new Entry [inCapacity]),
+mTimer (nullptr),
+mCapacity (inCapacity),
+mCount (0),
+mSentCount (0),
+mMissedCount (0) {
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_Scheduler:: ~ ACANFD_STM32_Scheduler (void) {
+  end () ;
+  delete [] mEntries ;
+}
+
+//------------------------------------------------------------------------------
+// Add periodic messages
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_Scheduler::addPeriodicMessage (const CANFDMessage & inMessage,
+                                                 const uint32_t inPeriodTicks,
+                                                 const PayloadProvider inProvider,
+                                                 const std::optional <uint32_t> inPhaseTicks) {
+  return internalAdd (inMessage, inPeriodTicks, inProvider, nullptr, inPhaseTicks) ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_Scheduler::addPeriodicMessageWithBuffer (const CANFDMessage & inMessage,
+                                                           const uint32_t inPeriodTicks,
+                                                           const volatile uint8_t * inPayloadBuffer,
+                                                           const std::optional <uint32_t> inPhaseTicks) {
+  return internalAdd (inMessage, inPeriodTicks, nullptr, inPayloadBuffer, inPhaseTicks) ;
+}
+
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_Scheduler::internalAdd (const CANFDMessage & inMessage,
+                                          const uint32_t inPeriodTicks,
+                                          const PayloadProvider inProvider,
+                                          const volatile uint8_t * inPayloadBuffer,
+                                          const std::optional <uint32_t> inPhaseTicks) {
+  const bool ok = (mCount < mCapacity) && (inPeriodTicks > 0) ;
+  if (ok) {
+    Entry & entry = mEntries [mCount] ;
+    entry.mMessage = inMessage ;
+    entry.mProvider = inProvider ;
+    entry.mPayloadBuffer = inPayloadBuffer ;
+    entry.mPeriod = inPeriodTicks ;
+    entry.mPhase = inPhaseTicks
+      ? (inPhaseTicks.value () % inPeriodTicks)
+      : leastCollidingPhase (inPeriodTicks)
+    ;
+    entry.mCountdown = entry.mPhase ;
+    mCount += 1 ;
+  }
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Phase spreading: messages with periods P1, P2 and phases F1, F2 are sent
+// during the same tick infinitely often iff F1 = F2 modulo GCD (P1, P2)
+
+static uint32_t gcd (const uint32_t inA, const uint32_t inB) {
+  uint32_t a = inA ;
+  uint32_t b = inB ;
+  while (b != 0) {
+    const uint32_t r = a % b ;
+    a = b ;
+    b = r ;
+  }
+  return a ;
+}
+
+//------------------------------------------------------------------------------
+
+uint32_t ACANFD_STM32_Scheduler::leastCollidingPhase (const uint32_t inPeriodTicks) const {
+  uint32_t * gcdArray = new uint32_t [mCount + 1] ;
+  for (uint32_t i=0 ; i<mCount ; i++) {
+    gcdArray [i] = gcd (inPeriodTicks, mEntries [i].mPeriod) ;
+  }
+  uint32_t bestPhase = 0 ;
+  uint32_t bestCollisionCount = UINT32_MAX ;
+  for (uint32_t phase = 0 ; (phase < inPeriodTicks) && (bestCollisionCount > 0) ; phase++) {
+    uint32_t collisionCount = 0 ;
+    for (uint32_t i=0 ; i<mCount ; i++) {
+      const uint32_t g = gcdArray [i] ;
+      if ((phase % g) == (mEntries [i].mPhase % g)) {
+        collisionCount += 1 ;
+      }
+    }
+    if (collisionCount < bestCollisionCount) {
+      bestCollisionCount = collisionCount ;
+      bestPhase = phase ;
+    }
+  }
+  delete [] gcdArray ;
+  return bestPhase ;
+}
+
+//------------------------------------------------------------------------------
+// Timer driven scheduling
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_Scheduler::begin (TIM_TypeDef * inTimer,
+                                    const uint32_t inTickPeriodMicros,
+                                    const std::optional <uint32_t> inInterruptPriority) {
+  end () ;
+//--- Not higher than FDCAN interrupt priority (lower value is higher priority)
+  const uint32_t driverPriority = mDriver.irqPriority () ;
+  const uint32_t priority = (inInterruptPriority && (inInterruptPriority.value () > driverPriority))
+    ? inInterruptPriority.value ()
+    : driverPriority
+  ;
+  mTimer = new HardwareTimer (inTimer) ;
+  mTimer->setOverflow (inTickPeriodMicros, MICROSEC_FORMAT) ;
+  mTimer->setInterruptPriority (priority, 0) ;
+  mTimer->attachInterrupt ([this] () { tick () ; }) ;
+  mTimer->resume () ;
+}
+
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_Scheduler::end (void) {
+  if (mTimer != nullptr) {
+    mTimer->pause () ;
+    mTimer->detachInterrupt () ;
+    delete mTimer ;
+    mTimer = nullptr ;
+  }
+}
+
+//------------------------------------------------------------------------------
+// Tick
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_Scheduler::tick (void) {
+  for (uint32_t i=0 ; i<mCount ; i++) {
+    Entry & entry = mEntries [i] ;
+    if (entry.mCountdown > 0) {
+      entry.mCountdown -= 1 ;
+    }else{
+      entry.mCountdown = entry.mPeriod - 1 ;
+    //--- Update payload
+      bool send = true ;
+      if (entry.mProvider != nullptr) {
+        send = entry.mProvider (entry.mMessage) ;
+      }else if (entry.mPayloadBuffer != nullptr) {
+        for (uint32_t j=0 ; j<entry.mMessage.len ; j++) {
+          entry.mMessage.data [j] = entry.mPayloadBuffer [j] ;
+        }
+      }
+    //--- Send
+      if (send) {
+        const uint32_t sendStatus = mDriver.tryToSendReturnStatusFD (entry.mMessage) ;
+        if (sendStatus == 0) {
+          mSentCount += 1 ;
+        }else{
+          mMissedCount += 1 ;
+        }
+      }
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
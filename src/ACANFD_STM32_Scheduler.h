@@ -0,0 +1,137 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_from_cpp.h>
+#include <HardwareTimer.h>
+
+#include <optional>
+
+//------------------------------------------------------------------------------
+// Periodic transmission scheduler: a table of periodic messages, sent by
+// tryToSendReturnStatusFD of the attached driver from the tick method, that is
+// called by a hardware timer interrupt (begin), or by the application.
+// Periods and phase offsets are expressed in ticks. When no phase offset is
+// given, addPeriodicMessage selects the phase that collides with the fewest
+// messages already in the table (two periodic messages collide if their phases
+// are congruent modulo the GCD of their periods), so that messages are spread
+// over ticks instead of being sent in bursts.
+// The payload of a message is either constant, updated by a provider callback
+// (called from tick before sending; returning false skips this cycle), or
+// copied from a buffer (len bytes).
+// Messages should be added before begin is called, and begin after the driver
+// beginFD. The timer interrupt priority is the FDCAN interrupt priority
+// (ACANFD_STM32::irqPriority), or inInterruptPriority if it is lower: the driver
+// transmit FIFO is also written by the application, a higher priority would
+// break driver critical sections, so a higher one is lowered.
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_Scheduler {
+
+  //············································································
+  // Payload provider
+  //············································································
+
+  public: typedef bool (*PayloadProvider) (CANFDMessage & ioMessage) ;
+
+  //············································································
+  // Constructor
+  //············································································
+
+  public: ACANFD_STM32_Scheduler (ACANFD_STM32 & inDriver,
+                                  const uint16_t inCapacity) ;
+
+  //············································································
+  // Destructor
+  //············································································
+
+  public: ~ ACANFD_STM32_Scheduler (void) ;
+
+  //············································································
+  // Add periodic messages (returns false if table is full, or period is 0)
+  //············································································
+
+  public: bool addPeriodicMessage (const CANFDMessage & inMessage,
+                                   const uint32_t inPeriodTicks,
+                                   const PayloadProvider inProvider = nullptr,
+                                   const std::optional <uint32_t> inPhaseTicks = std::nullopt) ;
+
+  public: bool addPeriodicMessageWithBuffer (const CANFDMessage & inMessage,
+                                             const uint32_t inPeriodTicks,
+                                             const volatile uint8_t * inPayloadBuffer,
+                                             const std::optional <uint32_t> inPhaseTicks = std::nullopt) ;
+
+  //············································································
+  // Timer driven scheduling
+  //············································································
+
+  public: void begin (TIM_TypeDef * inTimer,
+                      const uint32_t inTickPeriodMicros,
+                      const std::optional <uint32_t> inInterruptPriority = std::nullopt) ;
+
+  public: void end (void) ;
+
+  //············································································
+  // Tick (timer interrupt, or application if begin is not called)
+  //············································································
+
+  public: void tick (void) ;
+
+  //············································································
+  // Accessors
+  //············································································
+
+  public: inline uint16_t count (void) const { return mCount ; }
+  public: inline uint16_t capacity (void) const { return mCapacity ; }
+  public: inline uint32_t phaseOfMessageAtIndex (const uint16_t inIndex) const { return mEntries [inIndex].mPhase ; }
+  public: inline uint32_t sentCount (void) const { return mSentCount ; }
+  public: inline uint32_t missedCount (void) const { return mMissedCount ; } // tryToSend failures
+
+  //············································································
+  // Private methods
+  //············································································
+
+  private: uint32_t leastCollidingPhase (const uint32_t inPeriodTicks) const ;
+
+  private: bool internalAdd (const CANFDMessage & inMessage,
+                             const uint32_t inPeriodTicks,
+                             const PayloadProvider inProvider,
+                             const volatile uint8_t * inPayloadBuffer,
+                             const std::optional <uint32_t> inPhaseTicks) ;
+
+  //············································································
+  // Entry
+  //············································································
+
+  private: class Entry {
+    public: CANFDMessage mMessage ;
+    public: PayloadProvider mProvider = nullptr ;
+    public: const volatile uint8_t * mPayloadBuffer = nullptr ;
+    public: uint32_t mPeriod = 1 ;
+    public: uint32_t mPhase = 0 ;
+    public: uint32_t mCountdown = 0 ; // Ticks before next sending
+  } ;
+
+  //············································································
+  // Private properties
+  //············································································
+
+  private: ACANFD_STM32 & mDriver ;
+  private: Entry * mEntries ;
+  private: HardwareTimer * mTimer ;
+  private: const uint16_t mCapacity ;
+  private: uint16_t mCount ;
+  private: volatile uint32_t mSentCount ;
+  private: volatile uint32_t mMissedCount ;
+
+  //············································································
+  // No copy
+  //············································································
+
+  private: ACANFD_STM32_Scheduler (const ACANFD_STM32_Scheduler &) = delete ;
+  private: ACANFD_STM32_Scheduler & operator = (const ACANFD_STM32_Scheduler &) = delete ;
+} ;
+
+//------------------------------------------------------------------------------
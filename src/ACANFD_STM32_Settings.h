@@ -5,6 +5,7 @@
 //------------------------------------------------------------------------------
 
 #include <Arduino.h>
+#include <optional>
 
 //------------------------------------------------------------------------------
 
@@ -28,6 +29,8 @@
 
 #include <ACANFD_STM32_Filters.h>
 #include <ACANFD_STM32_DataBitRateFactor.h>
+#include <ACANFD_STM32_LatestValueCache.h>
+#include <ACANFD_STM32_FIFO.h>
 
 //------------------------------------------------------------------------------
 
@@ -50,6 +53,18 @@ class ACANFD_STM32_Settings {
     BUS_MONITORING
   } ModuleMode ;
 
+  public: typedef enum : uint8_t {
+    TIME_STAMP_DISABLED = 0, // Time stamp of received messages is always 0
+    TIME_STAMP_INTERNAL_COUNTER = 1, // Counts nominal bit times (divided by mTimeStampPrescaler)
+    TIME_STAMP_EXTERNAL_COUNTER = 2 // External time stamp counter (see reference manual, TIM3 on G0 / G4)
+  } TimeStampSource ;
+
+  public: typedef enum : uint8_t {
+    FIFO_DROP_NEWEST = 0, // Full driver FIFO drops the incoming frame, full hardware FIFO blocks
+    FIFO_OVERWRITE_OLDEST = 1, // Full driver FIFO drops its oldest frame, full hardware FIFO blocks
+    FIFO_HARDWARE_OVERWRITE = 2 // As FIFO_OVERWRITE_OLDEST, and full hardware FIFO overwrites its oldest frame
+  } FIFOOverflowPolicy ;
+
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   //    Constructors for a given bit rate
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -90,10 +105,103 @@ class ACANFD_STM32_Settings {
 //--- Module Mode
   public : ModuleMode mModuleMode = NORMAL_FD ;
 
-//--- Driver receive FIFO Sizes
+//--- Driver receive FIFO Sizes (at most ACANFD_STM32_FIFO::MAX_SIZE, 32767)
   public: uint16_t mDriverReceiveFIFO0Size = 60 ;
   public: uint16_t mDriverReceiveFIFO1Size = 60 ;
 
+//--- Driver FIFO storage: nullptr (default), beginFD allocates it on the heap;
+//    otherwise, storage is provided by the caller (for example static arrays,
+//    so that the linker reports the actual memory footprint), it should outlive
+//    the driver. setDriver...Storage set storage and FIFO size from array sizes.
+//    Transmit FIFO storage has a transmit options array and a slot order array
+//    (see ACANFD_STM32_FIFO) of the same size; if one of them is missing, beginFD
+//    returns kIncompleteDriverTransmitFIFOStorage.
+//    Receive FIFO storage may have a time stamp array of the same size (without
+//    it, time stamps are not stored).
+  public: CANFDMessage * mDriverTransmitFIFOStorage = nullptr ;
+  public: ACANFD_STM32_TxOptions * mDriverTransmitFIFOTxOptionsStorage = nullptr ;
+  public: uint16_t * mDriverTransmitFIFOSlotOrderStorage = nullptr ;
+  public: CANFDMessage * mDriverReceiveFIFO0Storage = nullptr ;
+  public: uint16_t * mDriverReceiveFIFO0TimeStampStorage = nullptr ;
+  public: CANFDMessage * mDriverReceiveFIFO1Storage = nullptr ;
+  public: uint16_t * mDriverReceiveFIFO1TimeStampStorage = nullptr ;
+
+  public: template <uint16_t SIZE> void setDriverTransmitFIFOStorage (CANFDMessage (& inMessages) [SIZE],
+                                                                      ACANFD_STM32_TxOptions (& inTxOptions) [SIZE],
+                                                                      uint16_t (& inSlotOrder) [SIZE]) {
+    mDriverTransmitFIFOStorage = inMessages ;
+    mDriverTransmitFIFOTxOptionsStorage = inTxOptions ;
+    mDriverTransmitFIFOSlotOrderStorage = inSlotOrder ;
+    mDriverTransmitFIFOSize = SIZE ;
+  }
+
+  public: template <uint16_t SIZE> void setDriverReceiveFIFO0Storage (CANFDMessage (& inMessages) [SIZE]) {
+    mDriverReceiveFIFO0Storage = inMessages ;
+    mDriverReceiveFIFO0TimeStampStorage = nullptr ;
+    mDriverReceiveFIFO0Size = SIZE ;
+  }
+
+  public: template <uint16_t SIZE> void setDriverReceiveFIFO0Storage (CANFDMessage (& inMessages) [SIZE],
+                                                                      uint16_t (& inTimeStamps) [SIZE]) {
+    mDriverReceiveFIFO0Storage = inMessages ;
+    mDriverReceiveFIFO0TimeStampStorage = inTimeStamps ;
+    mDriverReceiveFIFO0Size = SIZE ;
+  }
+
+  public: template <uint16_t SIZE> void setDriverReceiveFIFO1Storage (CANFDMessage (& inMessages) [SIZE]) {
+    mDriverReceiveFIFO1Storage = inMessages ;
+    mDriverReceiveFIFO1TimeStampStorage = nullptr ;
+    mDriverReceiveFIFO1Size = SIZE ;
+  }
+
+  public: template <uint16_t SIZE> void setDriverReceiveFIFO1Storage (CANFDMessage (& inMessages) [SIZE],
+                                                                      uint16_t (& inTimeStamps) [SIZE]) {
+    mDriverReceiveFIFO1Storage = inMessages ;
+    mDriverReceiveFIFO1TimeStampStorage = inTimeStamps ;
+    mDriverReceiveFIFO1Size = SIZE ;
+  }
+
+//--- Packed driver receive FIFOs: when not zero, driver receive FIFO 0 (1) is
+//    a packed ring of this byte size (see ACANFD_STM32_FIFO), where a frame takes
+//    8 bytes plus its payload: 16 bytes for an 8-byte frame, instead of 72
+//    (148 bytes of this size are taken by the FIFO staging messages).
+//    mDriverReceiveFIFO0Size (1) is then ignored. setDriverReceiveFIFO0PackedStorage
+//    and setDriverReceiveFIFO1PackedStorage provide caller storage (word array).
+//    mDriverReceiveFIFO0MaxPayload (1) is the largest payload of a packed FIFO,
+//    longer data frames are dropped (ACANFD_STM32::driverReceiveFIFO0PayloadDroppedCount,
+//    ...). beginFD rejects a value lower than the payload of hardware Rx FIFO
+//    elements (kDriverReceiveFIFOMaxPayloadTooSmall): 64 on fixed RAM devices,
+//    mHardwareRxFIFO0Payload (1) on programmable RAM devices. When it is lower
+//    than 64, and neither packed nor message storage is set, the FIFO is packed
+//    and sized for mDriverReceiveFIFO0Size (1) frames: a classic CAN application
+//    (8) uses 16 bytes per frame, instead of 72. For static storage, the word
+//    count is ACANFD_STM32_FIFO::packedStorageWordCount (frameCount, maxPayload).
+  public: uint32_t mDriverReceiveFIFO0PackedByteSize = 0 ;
+  public: uint32_t mDriverReceiveFIFO1PackedByteSize = 0 ;
+  public: uint8_t mDriverReceiveFIFO0MaxPayload = 64 ;
+  public: uint8_t mDriverReceiveFIFO1MaxPayload = 64 ;
+  public: uint32_t * mDriverReceiveFIFO0PackedStorage = nullptr ;
+  public: uint32_t * mDriverReceiveFIFO1PackedStorage = nullptr ;
+
+  public: template <uint32_t SIZE> void setDriverReceiveFIFO0PackedStorage (uint32_t (& inWords) [SIZE]) {
+    mDriverReceiveFIFO0PackedStorage = inWords ;
+    mDriverReceiveFIFO0PackedByteSize = 4 * SIZE ;
+  }
+
+  public: template <uint32_t SIZE> void setDriverReceiveFIFO1PackedStorage (uint32_t (& inWords) [SIZE]) {
+    mDriverReceiveFIFO1PackedStorage = inWords ;
+    mDriverReceiveFIFO1PackedByteSize = 4 * SIZE ;
+  }
+
+//--- Receive FIFO overflow policy. Dropped frames are counted by the driver
+//    (ACANFD_STM32::driverReceiveFIFO0DroppedCount, ...). Hardware FIFO blocking
+//    is relevant only when it is not emptied fast enough (poll mode, bounded
+//    receive interrupt, ...); a blocked hardware FIFO loses new frames (status flags bits 0 and 2).
+//    With an overwrite oldest policy, consumer methods run within a critical section,
+//    and peekFD0 / peekFD1 should not be used
+  public: FIFOOverflowPolicy mRxFIFO0OverflowPolicy = FIFO_DROP_NEWEST ;
+  public: FIFOOverflowPolicy mRxFIFO1OverflowPolicy = FIFO_DROP_NEWEST ;
+
 //--- Remote frame reception
   public: bool mDiscardReceivedStandardRemoteFrames = false ;
   public: bool mDiscardReceivedExtendedRemoteFrames = false ;
@@ -104,9 +212,31 @@ class ACANFD_STM32_Settings {
   public: void (*mNonMatchingStandardMessageCallBack) (const CANFDMessage & inMessage) = nullptr ;
   public: void (*mNonMatchingExtendedMessageCallBack) (const CANFDMessage & inMessage) = nullptr ;
 
-//--- Driver transmit buffer Size
+//--- Driver transmit buffer Size (at most ACANFD_STM32_FIFO::MAX_SIZE, 32767)
   public: uint16_t mDriverTransmitFIFOSize = 10 ;
 
+//--- Transmit priority queue: hardware Tx buffers run in Tx Queue mode (the
+//    pending message with the highest priority is sent first), and driver
+//    transmit buffer is ordered by arbitration priority (lowest identifier
+//    first, same identifier messages remain in order). Note a high priority
+//    message waits in driver transmit buffer if all hardware Tx Queue elements are pending.
+  public: bool mTransmitPriorityQueue = false ;
+
+//--- Blocking send (ACANFD_STM32::sendFD): while the message cannot be enqueued,
+//    the caller sleeps. By default (mTransmitWaitRoutine is nullptr), it executes
+//    WFI, and is woken by the next interrupt (isr0 when a hardware Tx buffer is
+//    released, SysTick, ...). With an RTOS, mTransmitWaitRoutine blocks the
+//    calling task at most inTimeoutMicros, and mTransmitSignalRoutine, called by
+//    isr0, wakes it; a signal sent before the wait should not be lost (binary
+//    semaphore, task notification).
+  public: void (*mTransmitWaitRoutine) (const uint32_t inTimeoutMicros) = nullptr ;
+  public: void (*mTransmitSignalRoutine) (void) = nullptr ;
+
+//--- Driver Tx event FIFO size (0: Tx events disabled). When enabled, every sent
+//    message requests a Tx event (EFC bit), that reports its marker, its transmit
+//    time stamp and its type (ACANFD_STM32::receiveTxEvent)
+  public: uint16_t mDriverTxEventFIFOSize = 0 ;
+
 //--- Automatic retransmission
   public: bool mEnableRetransmission = true ;
 
@@ -122,6 +252,50 @@ class ACANFD_STM32_Settings {
 //--- Rx Pin
   public: uint8_t mRxPin = 255 ; // By default, uses the first entry of Rx pin array
 
+//--- Time stamp counter (TSCC register): the 16-bit counter value is captured
+//    for every received message (ACANFD_STM32::receiveFD0 (message, timeStamp),
+//    ...). CANFDMessage is shared with other drivers: time stamps are stored by
+//    driver receive FIFOs in a parallel array, allocated by beginFD only if
+//    time stamps are enabled (packed FIFOs store them in message headers).
+//    The internal counter is incremented every mTimeStampPrescaler nominal bit
+//    times; as data phase bit time differs, it is not a constant time base for
+//    CANFD frames with bit rate switch. The external counter is common to all
+//    FDCAN modules: use it for ordering frames received by several modules.
+//    Its frequency (mExternalTimeStampFrequency) should be provided for
+//    converting ticks to microseconds (ACANFD_STM32::timeStampTicksToMicroseconds).
+  public: TimeStampSource mTimeStampSource = TIME_STAMP_DISABLED ;
+  public: uint8_t mTimeStampPrescaler = 1 ; // 1 ... 16
+  public: uint32_t mExternalTimeStampFrequency = 0 ; // In Hz
+
+//--- Receive interrupt execution time bound: isr1 handles at most
+//    mReceiveFrameBudget frames per invocation (0: no limit). When the budget is
+//    exhausted, remaining frames are handled:
+//      - if mDeferredReceiveIRQ is empty, by isr1 itself, that is pended again
+//        (pending interrupts with same or higher priority are served first).
+//        The budget alone does not bound interrupt latency: isr1 runs again
+//        right after, so lower priority interrupts still wait until all
+//        received frames are handled. Set mDeferredReceiveIRQ for a bound;
+//      - otherwise by ACANFD_STM32::deferredReceive, that should be called from
+//        the mDeferredReceiveIRQ handler (PendSV_IRQn, whose priority is not
+//        changed, or an unused IRQ, that beginFD enables with a priority just
+//        lower than FDCAN interrupts). Until it has run, receive interrupts of
+//        the FDCAN module are disabled.
+  public: uint16_t mReceiveFrameBudget = 0 ;
+  public: std::optional <IRQn_Type> mDeferredReceiveIRQ = std::nullopt ;
+
+//--- Latest value cache: received frames whose identifier is in the cache
+//    update the cache entry instead of being appended to driver receive FIFOs.
+//    The cache is not owned by the driver, it should outlive it.
+  public: ACANFD_STM32_LatestValueCache * mLatestValueCache = nullptr ;
+
+//--- FDCAN interrupts NVIC priority: 0 (highest) ... (1 << __NVIC_PRIO_BITS) - 1 (lowest)
+//    Empty (default): beginFD does not change NVIC priorities of FDCAN interrupts
+//    (the reset value is 0, unless set by the application before calling beginFD).
+//    Driver critical sections only mask interrupts with a priority lower than or
+//    equal to the actual one, see ACANFD_STM32::irqPriority (except on Cortex-M0+,
+//    or if priority is 0: all interrupts are masked)
+  public: std::optional <uint8_t> mIRQPriority = std::nullopt ;
+
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
   // Accessors
   // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
@@ -213,12 +387,36 @@ class ACANFD_STM32_Settings {
       public: uint8_t mHardwareRxFIFO1Size = 2 ; // 0 ... 64
       public: Payload mHardwareRxFIFO1Payload = PAYLOAD_64_BYTES ;
 
+    //--- Receive interrupt coalescing: a non zero watermark replaces the "new
+    //    message" interrupt of a hardware Rx FIFO by the watermark interrupt,
+    //    raised when its fill level reaches the watermark (values greater than
+    //    the FIFO size are reduced to the FIFO size).
+    //    A non zero timeout (in time stamp counter prescaler ticks, that is
+    //    mTimeStampPrescaler nominal bit times) starts the timeout counter when a
+    //    message enters the empty Rx FIFO, so a lone message is not held longer.
+    //    There is only one timeout counter: it watches Rx FIFO 0 if its watermark
+    //    is enabled, Rx FIFO 1 otherwise. So with a non zero timeout, Rx FIFO 1
+    //    watermark is ignored if Rx FIFO 0 watermark is enabled (Rx FIFO 1 keeps
+    //    its "new message" interrupt).
+      public: uint8_t mHardwareRxFIFO0Watermark = 0 ; // 0 (disabled) ... 64
+      public: uint8_t mHardwareRxFIFO1Watermark = 0 ; // 0 (disabled) ... 64
+      public: uint16_t mHardwareRxFIFOCoalescingTimeout = 0 ; // 0 (disabled) ... 65535
+
+    //--- Hardware dedicated Rx buffers, filled by filters defined with addRxBuffer
+    //    (beginFD checks their Rx buffer index is lower than mHardwareRxBufferCount)
+      public: uint8_t mHardwareRxBufferCount = 0 ; // 0 ... 64
+      public: Payload mHardwareRxBufferPayload = PAYLOAD_64_BYTES ;
+
     //--- Hardware Transmit Buffers
     //    Required: mHardwareTransmitTxFIFOSize + mHardwareDedicacedTxBufferCount <= 32
       public: uint8_t mHardwareTransmitTxFIFOSize = 10 ; // 1 ... 32
       public: uint8_t mHardwareDedicacedTxBufferCount = 1 ; // 0 ... 30
       public: Payload mHardwareTransmitBufferPayload = PAYLOAD_64_BYTES ;
 
+    //--- Hardware Tx Event FIFO, allocated only if mDriverTxEventFIFOSize > 0
+    //    (values greater than 32 are reduced to 32)
+      public: uint8_t mHardwareTxEventFIFOSize = 4 ; // 1 ... 32
+
     // - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - - -
 
   #endif
@@ -0,0 +1,82 @@
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_TxEventFIFO.h>
+
+//------------------------------------------------------------------------------
+// Default constructor
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_TxEventFIFO::ACANFD_STM32_TxEventFIFO (void) :
+ACANFD_STM32_RingIndexes (),
+mBuffer (nullptr) {
+}
+
+//------------------------------------------------------------------------------
+// Destructor
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_TxEventFIFO:: ~ ACANFD_STM32_TxEventFIFO (void) {
+  delete [] mBuffer ;
+}
+
+//------------------------------------------------------------------------------
+// initWithSize
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_TxEventFIFO::initWithSize (const uint16_t inSize) {
+  delete [] mBuffer ;
+  resetRing (inSize) ;
+  mBuffer = (mSize > 0) ? new ACANFD_STM32_TxEvent [mSize] : nullptr ;
+}
+
+//------------------------------------------------------------------------------
+// Reserve
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+ACANFD_STM32_TxEvent * ACANFD_STM32_TxEventFIFO::reserve (void) {
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_acquire) ;
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_relaxed) ;
+  ACANFD_STM32_TxEvent * slotPtr = nullptr ;
+  if (countFor (readIndex, writeIndex) < mSize) {
+    slotPtr = & mBuffer [slotFor (writeIndex)] ;
+  }else{
+    recordOverflow () ;
+  }
+  return slotPtr ;
+}
+
+//------------------------------------------------------------------------------
+// Commit
+//------------------------------------------------------------------------------
+
+ACANFD_STM32_FAST_CODE
+void ACANFD_STM32_TxEventFIFO::commit (void) {
+  publishSlot (mWriteIndex.load (std::memory_order_relaxed)) ;
+}
+
+//------------------------------------------------------------------------------
+// Remove
+//------------------------------------------------------------------------------
+
+bool ACANFD_STM32_TxEventFIFO::remove (ACANFD_STM32_TxEvent & outEvent) {
+  const uint16_t writeIndex = mWriteIndex.load (std::memory_order_acquire) ;
+  const uint16_t readIndex = mReadIndex.load (std::memory_order_relaxed) ;
+  const bool ok = readIndex != writeIndex ;
+  if (ok) {
+    outEvent = mBuffer [slotFor (readIndex)] ;
+    mReadIndex.store (nextIndex (readIndex), std::memory_order_release) ;
+  }
+  return ok ;
+}
+
+//------------------------------------------------------------------------------
+// Free
+//------------------------------------------------------------------------------
+
+void ACANFD_STM32_TxEventFIFO::free (void) {
+  delete [] mBuffer ; mBuffer = nullptr ;
+  resetRing (0) ;
+}
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,99 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_CANFDMessage.h>
+#include <ACANFD_STM32_FastMemory.h>
+#include <ACANFD_STM32_RingIndexes.h>
+
+//------------------------------------------------------------------------------
+//    Tx event: reports the actual transmission of a message sent by the
+//    driver (see ACANFD_STM32_Settings::mDriverTxEventFIFOSize)
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_TxEvent {
+  public: uint32_t id = 0 ;  // Frame identifier
+  public: bool ext = false ; // false -> base frame, true -> extended frame
+  public: CANFDMessage::Type type = CANFDMessage::CAN_DATA ; // FDF, BRS and RTR bits of sent frame
+  public: uint8_t len = 0 ; // Length of data (0 ... 64)
+  public: uint8_t marker = 0 ; // Marker of sent message
+  public: uint16_t timeStamp = 0 ; // Transmit time stamp (counter ticks, see ACANFD_STM32_Settings)
+} ;
+
+//------------------------------------------------------------------------------
+// Single producer (isr0) / single consumer ring of Tx events (see
+// ACANFD_STM32_RingIndexes). When it is full, new events are dropped and
+// counted (droppedCount).
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_TxEventFIFO : public ACANFD_STM32_RingIndexes {
+
+  //············································································
+  // Default constructor
+  //············································································
+
+  public: ACANFD_STM32_TxEventFIFO (void) ;
+
+  //············································································
+  // Destructor
+  //············································································
+
+  public: ~ ACANFD_STM32_TxEventFIFO (void) ;
+
+  //············································································
+  // Private properties
+  //············································································
+
+  private: ACANFD_STM32_TxEvent * mBuffer ;
+
+  //············································································
+  // Accessors
+  //············································································
+
+  public: inline uint16_t count (void) const { return ringCount () ; }
+
+  //············································································
+  // initWithSize
+  //············································································
+
+  public: void initWithSize (const uint16_t inSize) ;
+
+  //············································································
+  // In place append (producer): reserve returns the next free slot (nullptr
+  // if FIFO is full, overflow and dropped event are then recorded), commit
+  // enters it into the FIFO
+  //············································································
+
+  public: ACANFD_STM32_TxEvent * reserve (void) ;
+
+  public: void commit (void) ;
+
+  //············································································
+  // Remove (consumer)
+  //············································································
+
+  public: bool remove (ACANFD_STM32_TxEvent & outEvent) ;
+
+  //············································································
+  // Free
+  //············································································
+
+  public: void free (void) ;
+
+  //············································································
+  // Reset Peak Count
+  //············································································
+
+  public: inline void resetPeakCount (void) { mPeakCount = count () ; }
+
+  //············································································
+  // No copy
+  //············································································
+
+  private: ACANFD_STM32_TxEventFIFO (const ACANFD_STM32_TxEventFIFO &) = delete ;
+  private: ACANFD_STM32_TxEventFIFO & operator = (const ACANFD_STM32_TxEventFIFO &) = delete ;
+} ;
+
+//------------------------------------------------------------------------------
@@ -0,0 +1,35 @@
+//------------------------------------------------------------------------------
+
+#pragma once
+
+//------------------------------------------------------------------------------
+
+#include <ACANFD_STM32_CANFDMessage.h>
+
+//------------------------------------------------------------------------------
+//  Uninitialized message storage (driver side)
+//------------------------------------------------------------------------------
+// CANFDMessage default constructor clears its 64-byte payload. Driver
+// temporaries that are written before being read (interrupt and dispatch paths)
+// use this storage instead, CANFDMessage is shared with other CANFD drivers and
+// is not changed:
+//   ACANFD_STM32_UninitializedMessage storage ;
+//   CANFDMessage & message = storage.message () ;
+// All properties of the message are undefined until they are written.
+//------------------------------------------------------------------------------
+
+class ACANFD_STM32_UninitializedMessage {
+
+  private: alignas (CANFDMessage) uint8_t mStorage [sizeof (CANFDMessage)] ;
+
+  public: inline ACANFD_STM32_UninitializedMessage (void) { }
+
+  public: inline CANFDMessage & message (void) {
+    return * reinterpret_cast <CANFDMessage *> (mStorage) ;
+  }
+
+  private: ACANFD_STM32_UninitializedMessage (const ACANFD_STM32_UninitializedMessage &) = delete ;
+  private: ACANFD_STM32_UninitializedMessage & operator = (const ACANFD_STM32_UninitializedMessage &) = delete ;
+} ;
+
+//------------------------------------------------------------------------------